@@ -6,53 +6,1157 @@
 #include <algorithm>
 #include <map>
 #include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <list>
+#include <unordered_map>
+#include <csignal>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+#include <random>
+#include <cstdlib>
+#include <new>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#define DM_HAVE_EPOLL 1
+#endif
+
+#if defined(DM_INSTRUMENT) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#define DM_HAVE_PERF 1
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define DM_HAVE_X86_SIMD 1
+#endif
 
 using namespace std;
 using namespace std::chrono;
 
-vector<long long> memo;
+// Hot-path instrumentation. Build with -DDM_INSTRUMENT to count calls and
+// peak recursion depth at each probe site and every heap allocation; without
+// it DM_PROBE expands to nothing and operator new is the library's own.
+enum ProbeSite { PROBE_FIBONACCI_RECURSIVE, PROBE_LUCAS_RECURSIVE, PROBE_HANOI_RECURSIVE, PROBE_COUNT };
+
+#ifdef DM_INSTRUMENT
+struct ProbeCounters {
+    atomic<unsigned long long> calls;
+    atomic<int> peak_depth;
+};
+
+ProbeCounters probe_counters[PROBE_COUNT];
+atomic<unsigned long long> allocated_bytes, allocation_count;
+thread_local int probe_depth[PROBE_COUNT];
+
+// Counts one call and tracks the current thread's depth for its lifetime
+class ProbeScope {
+public:
+    explicit ProbeScope(ProbeSite site) : site(site) {
+        probe_counters[site].calls.fetch_add(1, memory_order_relaxed);
+        int depth = ++probe_depth[site];
+        int peak = probe_counters[site].peak_depth.load(memory_order_relaxed);
+        while (depth > peak && !probe_counters[site].peak_depth.compare_exchange_weak(peak, depth, memory_order_relaxed)) {}
+    }
+    ~ProbeScope() { --probe_depth[site]; }
+    
+private:
+    ProbeSite site;
+};
+
+#define DM_PROBE(site) ProbeScope probe_scope(site)
+#else
+#define DM_PROBE(site) ((void)0)
+#endif
+
+// CPU cycles, instructions and cache misses for the calling thread, read via
+// perf_event_open. available() is false when compiled out, off Linux, or when
+// the kernel refuses (e.g. perf_event_paranoid or a container without PMU access).
+class HardwareCounters {
+public:
+    HardwareCounters();
+    ~HardwareCounters();
+    
+    bool available() const { return fds[0] >= 0; }
+    void start();
+    void stop();
+    
+    unsigned long long cycles, instructions, cache_misses;
+    
+private:
+    int fds[3];
+    
+    HardwareCounters(const HardwareCounters&);
+    HardwareCounters& operator=(const HardwareCounters&);
+};
+
+// Grow-only store of sequence terms shared by every memoized path. Terms live
+// in segments of doubling size (segment s holds 2^s terms) that never move
+// once allocated, so readers index them without a lock after an acquire load
+// of the published size. Only growth takes the mutex, and it fills the new
+// terms bottom-up. Indices past last (the final term that fits in a long
+// long) are refused with -1, so a large n cannot make the store grow.
+class SharedMemo {
+public:
+    SharedMemo(unsigned long long first, unsigned long long second, int last);
+    ~SharedMemo();
+    
+    long long get(int n);
+    int last() const { return last_index; }
+    size_t size() const { return filled.load(memory_order_acquire); }
+    unsigned long long hits() const { return hit_count.load(memory_order_relaxed); }
+    unsigned long long misses() const { return miss_count.load(memory_order_relaxed); }
+    
+private:
+    static const int MAX_SEGMENTS = 32;
+    
+    unsigned long long& slot(size_t index);
+    
+    unsigned long long initial[2];
+    int last_index;
+    atomic<unsigned long long*> segments[MAX_SEGMENTS];
+    atomic<size_t> filled;
+    mutex grow_mutex;
+    atomic<unsigned long long> hit_count, miss_count;
+    
+    SharedMemo(const SharedMemo&);
+    SharedMemo& operator=(const SharedMemo&);
+};
+
+SharedMemo fibonacci_memo(0, 1, 92);
+SharedMemo lucas_memo(2, 1, 90);
+
+// Arbitrary-precision unsigned integer, stored as little-endian base 2^32 limbs
+// with no leading zero limbs (zero is the empty vector).
+typedef vector<uint32_t> Limbs;
+
+class BigInt {
+public:
+    Limbs limbs;
+    
+    BigInt() {}
+    BigInt(unsigned long long value);
+    
+    bool isZero() const { return limbs.empty(); }
+    size_t bitLength() const;
+    unsigned long long mod(unsigned long long m) const;
+    string toString() const;
+    
+    BigInt& operator+=(const BigInt& other);
+    BigInt& operator-=(const BigInt& other); // requires *this >= other
+    BigInt& operator>>=(int bits);
+    BigInt mulSmall(uint32_t factor) const;
+};
+
+BigInt operator+(const BigInt& a, const BigInt& b);
+BigInt operator-(const BigInt& a, const BigInt& b);
+BigInt operator*(const BigInt& a, const BigInt& b);
+int compare(const BigInt& a, const BigInt& b);
+
+// 10^(9 * 2^level) and, once it is large, floor(2^(64k) / power) for its k
+// limbs, so that splitting a number by it is a Barrett step of two products
+// rather than a quadratic long division.
+struct DecimalPower {
+    Limbs power;
+    Limbs reciprocal; // empty below RECIPROCAL_THRESHOLD limbs
+};
+
+// Buffered text output for long listings and huge terms. Numbers are written
+// with to_chars (BigInt through the radix converter) straight into one buffer
+// that goes out with a single fwrite when it fills, instead of a flush per
+// line as with endl.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(FILE* out, size_t capacity = 1 << 20) : out(out), capacity(capacity), ok(true) {
+        buffer.reserve(capacity);
+    }
+    ~OutputBuffer() { flush(); }
+    
+    OutputBuffer& operator<<(char c) { buffer += c; return spill(); }
+    OutputBuffer& operator<<(const char* text) { buffer += text; return spill(); }
+    OutputBuffer& operator<<(const string& text) { buffer += text; return spill(); }
+    OutputBuffer& operator<<(const BigInt& value);
+    template <class T, class = typename enable_if<is_integral<T>::value>::type>
+    OutputBuffer& operator<<(T value) {
+        char text[24];
+        buffer.append(text, to_chars(text, text + sizeof(text), value).ptr);
+        return spill();
+    }
+    
+    bool flush(); // false once any write has failed
+    
+private:
+    FILE* out;
+    size_t capacity;
+    string buffer;
+    bool ok;
+    
+    OutputBuffer& spill() {
+        if (buffer.size() >= capacity) flush();
+        return *this;
+    }
+    
+    OutputBuffer(const OutputBuffer&);
+    OutputBuffer& operator=(const OutputBuffer&);
+};
+
+// Bit stream packed least significant bit first into 64-bit words
+class BitWriter {
+public:
+    BitWriter() : bits(0) {}
+    
+    void write(uint64_t value, int count); // the low count bits, count <= 64
+    const vector<uint64_t>& words() const { return data; }
+    size_t size() const { return bits; }
+    
+private:
+    vector<uint64_t> data;
+    size_t bits;
+};
+    
+class BitReader {
+public:
+    BitReader(const vector<uint64_t>& words, size_t bits) : data(words.data()), word_count(words.size()), bits(bits), pos(0) {}
+    
+    uint64_t peek() const; // the next 64 bits, zero past the end
+    void skip(size_t count) { pos += count; }
+    uint64_t read(int count);
+    size_t position() const { return pos; }
+    bool done() const { return pos >= bits; }
+    
+private:
+    const uint64_t* data;
+    size_t word_count, bits, pos;
+};
+
+// Lookup tables for Fibonacci coding, built once from fibonacci_sequence
+struct FibonacciCodeTables {
+    vector<uint64_t> terms;                 // terms[j] = F(j + 2), every term below 2^64
+    vector<int> below_bits;                 // [b]: largest j with terms[j] < 2^b
+    vector<array<uint64_t, 256>> byte_sums; // [p][x]: sum of terms[8p + j] over set bits j of x
+    vector<uint32_t> small_codes;           // [v]: code word of v, its length in the top 8 bits
+};
+    
+// One move of the optimal 3-peg Tower of Hanoi solution. Pegs are numbered
+// 0, 1, 2 for rods A, B, C; disk 1 is the smallest.
+struct HanoiMove {
+    int disk;
+    int from;
+    int to;
+};
+
+// Streams the moves of the optimal n-disk solution from rod A to rod C
+// without storing them. Move k (1-based) is computed in O(1) from its bits:
+// it moves disk ctz(k) + 1 from peg (k & (k-1)) % 3 to peg ((k | (k-1)) + 1) % 3,
+// which carries the tower to C for odd n and to B for even n, so even n
+// swaps B and C. Supports range-for and a next() cursor; no heap use.
+class HanoiMoves {
+public:
+    static const int MAX_DISKS = 63;
+    
+    class iterator {
+    public:
+        iterator(uint64_t move_number, bool swap) : k(move_number), swap_pegs(swap) {}
+        HanoiMove operator*() const;
+        iterator& operator++() { k++; return *this; }
+        bool operator!=(const iterator& other) const { return k != other.k; }
+        uint64_t moveNumber() const { return k; }
+    private:
+        uint64_t k;
+        bool swap_pegs;
+    };
+    
+    explicit HanoiMoves(int disks);
+    HanoiMoves(int disks, uint64_t first, uint64_t last); // moves first..last inclusive
+    
+    iterator begin() const { return iterator(first_move, swap_pegs); }
+    iterator end() const { return iterator(last_move + 1, swap_pegs); }
+    bool next(HanoiMove& move);
+    uint64_t total() const { return last_move - first_move + 1; }
+    
+private:
+    uint64_t first_move, last_move, cursor;
+    bool swap_pegs;
+};
+
+// Frame-Stewart table: moves[n][p] is the fewest moves for n disks on p pegs
+// under the Frame-Stewart strategy (park the top split[n][p] disks on a spare
+// peg using all p pegs, move the rest with p - 1 pegs, bring the top back).
+// Counts saturate at the largest MoveCount.
+struct FrameStewartTable {
+    int max_disks, max_pegs;
+    vector<unsigned __int128> moves;
+    vector<int> split;
+    
+    size_t index(int n, int p) const { return static_cast<size_t>(n) * (max_pegs + 1) + p; }
+};
+
+// Streams the Frame-Stewart solution for n disks from the first peg to the
+// last with the same next() / range-for interface as HanoiMoves. Moves come
+// from an explicit stack of (disks, pegs, from, to) frames, so the cost per
+// move is amortised O(1) and memory is O(disks).
+class MultiPegMoves {
+public:
+    class iterator {
+    public:
+        iterator(MultiPegMoves* source) : moves(source) { ++*this; }
+        HanoiMove operator*() const { return current; }
+        iterator& operator++() { if (moves && !moves->next(current)) moves = 0; return *this; }
+        bool operator!=(const iterator& other) const { return moves != other.moves; }
+    private:
+        MultiPegMoves* moves;
+        HanoiMove current;
+    };
+    
+    MultiPegMoves(int disks, int pegs);
+    
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(0); }
+    bool next(HanoiMove& move);
+    unsigned __int128 total() const { return total_moves; }
+    
+private:
+    struct Frame {
+        int disks, base; // moves disks base+1 .. base+disks
+        int from, to, via;
+        unsigned usable; // bitmask of pegs this subproblem may use
+        int stage;
+    };
+    
+    shared_ptr<const FrameStewartTable> table;
+    vector<Frame> frames;
+    unsigned __int128 total_moves;
+};
+
+// Tower state with each peg stored as a bitmask of its disks (bit d-1 for
+// disk d, 64 disks per word). A move is legal when the disk is the lowest
+// set bit of its source peg and the target has no lower bit, so with one
+// word apply() is a couple of masks and compares.
+class PegSimulator {
+public:
+    PegSimulator(int disks, int pegs); // every disk starts on peg 0
+    
+    bool apply(const HanoiMove& move) {
+        if (move.disk < 1 || move.disk > disks || move.from == move.to ||
+            static_cast<unsigned>(move.from) >= static_cast<unsigned>(pegs) ||
+            static_cast<unsigned>(move.to) >= static_cast<unsigned>(pegs)) return false;
+        if (words > 1) return apply_wide(move);
+        uint64_t bit = uint64_t(1) << (move.disk - 1), below = bit - 1;
+        uint64_t& from = rods[move.from];
+        uint64_t& to = rods[move.to];
+        if ((from & (bit | below)) != bit || (to & below)) return false;
+        from ^= bit;
+        to |= bit;
+        return true;
+    }
+    string explain(const HanoiMove& move) const; // why apply() refused the move
+    bool solved(int peg) const;                  // every disk on peg
+    int top(int peg) const;                      // smallest disk on peg, 0 if empty
+    
+private:
+    bool apply_wide(const HanoiMove& move);
+    bool holds(int peg, int disk) const { return (rods[peg * words + (disk - 1) / 64] >> ((disk - 1) % 64)) & 1; }
+    
+    int disks, pegs, words;
+    vector<uint64_t> rods; // pegs x words
+};
+
+// Reads moves from a file written by the exporter: binary ("DMHANOI1" header,
+// two bytes per move) or text lines "disk from to" with rods as letters.
+class MoveFileReader {
+public:
+    MoveFileReader() : file(0), pos(0), end(0), is_binary(false), header_disks(0), bad(false), at_eof(false) {}
+    ~MoveFileReader() { if (file) fclose(file); }
+    
+    bool open(const string& path, string& error);
+    bool next(HanoiMove& move); // false at the end of the file or on a malformed record
+    bool binary() const { return is_binary; }
+    int disks() const { return header_disks; } // from the binary header, 0 for text
+    bool malformed() const { return bad; }
+    
+private:
+    bool fill();
+    
+    FILE* file;
+    vector<char> buffer;
+    size_t pos, end;
+    bool is_binary;
+    int header_disks;
+    bool bad, at_eof;
+    
+    MoveFileReader(const MoveFileReader&);
+    MoveFileReader& operator=(const MoveFileReader&);
+};
+
+// Least-recently-used map from a normalised query to its answer line,
+// bounded both by entry count and by the bytes of keys and answers held
+class LruCache {
+public:
+    LruCache(size_t capacity, size_t max_bytes)
+        : capacity(capacity), max_bytes(max_bytes), held_bytes(0), hit_count(0), miss_count(0) {}
+    
+    bool get(const string& key, string& value);
+    void put(const string& key, const string& value); // answers over max_bytes are not kept
+    size_t size() const { return index.size(); }
+    size_t bytes() const { return held_bytes; }
+    unsigned long long hits() const { return hit_count; }
+    unsigned long long misses() const { return miss_count; }
+    
+private:
+    typedef list<pair<string, string>> Entries;
+    
+    size_t capacity, max_bytes, held_bytes;
+    Entries entries; // most recently used first
+    unordered_map<string, Entries::iterator> index;
+    unsigned long long hit_count, miss_count;
+};
+
+// Read-only view of a precomputed term file (--build-store). Holds the
+// complete 128-bit tables, Pisano periods of small moduli and big-integer
+// checkpoints F(k*2^j), L(k*2^j) for k = 1..per_level. The file is mapped
+// once at startup, so concurrent processes share its pages.
+struct TermStoreHeader {
+    char magic[8];      // "DMTERMS" followed by a zero byte
+    uint32_t version;
+    uint32_t byte_order; // 0x01020304 in the writer's byte order
+    uint32_t min_level, max_level, per_level;
+    uint32_t wide_fibonacci, wide_lucas; // entries in the 128-bit tables
+    uint32_t pisano_moduli;              // periods stored for m < pisano_moduli
+    uint64_t wide_offset, pisano_offset, directory_offset, file_size;
+};
+
+// Limbs of F(c) start at offset; those of L(c) follow them
+struct StoreCheckpoint {
+    uint64_t offset;
+    uint32_t f_limbs, l_limbs;
+};
+
+class TermStore {
+public:
+    static const uint32_t VERSION = 1;
+    
+    TermStore() : data(0), size(0), header(0) {}
+    ~TermStore() { close(); }
+    
+    bool open(const string& path, string& error);
+    void close();
+    bool isOpen() const { return header != 0; }
+    const TermStoreHeader* info() const { return header; }
+    
+    bool checkpoint(unsigned long long n, unsigned long long& c) const; // largest useful c <= n
+    void load(unsigned long long c, BigInt& f, BigInt& l) const;
+    bool wide(long long n, bool lucas, unsigned __int128& value) const;
+    bool pisano(uint64_t m, unsigned __int128& period) const;
+    
+private:
+    const char* data;
+    size_t size;
+    const TermStoreHeader* header;
+    
+    TermStore(const TermStore&);
+    TermStore& operator=(const TermStore&);
+};
+
+TermStore term_store;
+
+// A curve reduced to one [low, high] range per output column, so plotting
+// 10^7 points needs only O(columns) memory and every extreme survives.
+struct PlotData {
+    string title, y_label;
+    long long first, last;
+    bool log_x;
+    vector<double> low, high;
+    vector<char> filled;
+    double y_min, y_max;
+};
+
+// Visited table for the configuration search: 2 bits per packed state
+// (2 bits per disk, so at most 4 pegs), holding 0 for unseen or
+// 1 + distance mod 3. Neighbouring states differ in distance by at most one,
+// so distance mod 3 is enough to walk a shortest path back to the root.
+class DistanceTable {
+public:
+    explicit DistanceTable(int disks) : cells((size_t(1) << (2 * disks)) / 4 + 1, 0) {}
+    
+    int get(uint32_t state) const { return (cells[state >> 2] >> ((state & 3) * 2)) & 3; }
+    void set(uint32_t state, int distance) {
+        cells[state >> 2] = static_cast<uint8_t>(cells[state >> 2] | ((distance % 3 + 1) << ((state & 3) * 2)));
+    }
+    
+private:
+    vector<uint8_t> cells;
+};
+
+// Compile-time tables of every Fibonacci and Lucas term that fits in 64 bits
+template <size_t N>
+constexpr array<unsigned long long, N> make_recurrence_table(unsigned long long a0, unsigned long long a1) {
+    array<unsigned long long, N> table{};
+    table[0] = a0;
+    table[1] = a1;
+    for (size_t i = 2; i < N; i++) table[i] = table[i - 1] + table[i - 2];
+    return table;
+}
+
+constexpr array<unsigned long long, 94> FIBONACCI_TABLE = make_recurrence_table<94>(0, 1);
+constexpr array<unsigned long long, 93> LUCAS_TABLE = make_recurrence_table<93>(2, 1);
+static_assert(FIBONACCI_TABLE[93] == 12200160415121876738ULL, "F(93) is the last 64-bit Fibonacci term");
+static_assert(LUCAS_TABLE[92] == 16860207025497407047ULL, "L(92) is the last 64-bit Lucas term");
+
+// A term from the tiered dispatcher, held in the narrowest representation
+// it fits in: table lookup (64-bit), checked 128-bit doubling, or big integer.
+struct TermValue {
+    enum Tier { TABLE_64, WIDE_128, BIG };
+    Tier tier;
+    unsigned long long small;
+    unsigned __int128 wide;
+    BigInt big;
+    
+    string toString() const;
+    const char* tierName() const;
+};
+
+// Sign-magnitude big integer, used for the intermediate terms of Toom-3 and
+// for recurrences whose terms may be negative
+struct SignedLimbs {
+    Limbs mag;
+    bool neg;
+    SignedLimbs(const Limbs& m = Limbs(), bool negative = false) : mag(m), neg(negative && !m.empty()) {}
+};
+
+SignedLimbs signed_add(const SignedLimbs& x, const SignedLimbs& y);
+SignedLimbs signed_sub(const SignedLimbs& x, const SignedLimbs& y);
+SignedLimbs signed_mul(const SignedLimbs& x, const SignedLimbs& y);
+SignedLimbs signed_div_exact(SignedLimbs x, uint32_t d);
+
+// Montgomery multiplication for any odd 64-bit modulus. Values are kept in
+// Montgomery form (x * 2^64 mod m) between toForm and fromForm.
+struct Montgomery64 {
+    typedef uint64_t Value;
+    uint64_t m, m_inv, r2; // m_inv = m^-1 mod 2^64, r2 = 2^128 mod m
+    
+    Montgomery64(uint64_t modulus = 1);
+    uint64_t reduce(unsigned __int128 t) const;
+    uint64_t toForm(uint64_t x) const { return reduce(static_cast<unsigned __int128>(x % m) * r2); }
+    uint64_t fromForm(uint64_t x) const { return reduce(x); }
+    uint64_t mul(uint64_t a, uint64_t b) const { return reduce(static_cast<unsigned __int128>(a) * b); }
+    uint64_t add(uint64_t a, uint64_t b) const { uint64_t s = a + b; return (s < a || s >= m) ? s - m : s; }
+    uint64_t sub(uint64_t a, uint64_t b) const { return a >= b ? a - b : a + m - b; }
+    uint64_t half(uint64_t a) const { return (a & 1) ? (a >> 1) + (m >> 1) + 1 : a >> 1; } // a / 2 mod m
+};
+
+// Montgomery arithmetic modulo a big odd m with R = 2^(32k) for a k-limb m.
+// Reduction is two products through limbs_mul rather than a word-by-word
+// loop, so it inherits Karatsuba and Toom-3 on multi-thousand-digit moduli.
+struct MontgomeryBig {
+    typedef Limbs Value;
+    Limbs m, m_inv, r2; // m_inv = m^-1 mod R, r2 = R^2 mod m
+    size_t k;
+    
+    MontgomeryBig(const Limbs& modulus);
+    Limbs reduce(const Limbs& t) const;
+    Limbs toForm(const Limbs& x) const { return mul(x, r2); } // x < m
+    Limbs toForm(uint64_t x) const { return toForm(BigInt(x).limbs); }
+    Limbs fromForm(const Limbs& x) const { return reduce(x); }
+    Limbs mul(const Limbs& a, const Limbs& b) const;
+    Limbs add(const Limbs& a, const Limbs& b) const;
+    Limbs sub(const Limbs& a, const Limbs& b) const;
+    Limbs half(const Limbs& a) const;
+};
+
+// Barrett reduction for any modulus below 2^63 (used for even moduli, where
+// Montgomery form does not exist). mu = floor((2^128 - 1) / m).
+struct Barrett64 {
+    typedef uint64_t Value;
+    uint64_t m;
+    unsigned __int128 mu;
+    
+    Barrett64(uint64_t modulus = 1);
+    uint64_t reduce(unsigned __int128 x) const;
+    uint64_t toForm(uint64_t x) const { return x % m; }
+    uint64_t fromForm(uint64_t x) const { return x; }
+    uint64_t mul(uint64_t a, uint64_t b) const { return reduce(static_cast<unsigned __int128>(a) * b); }
+    uint64_t add(uint64_t a, uint64_t b) const { uint64_t s = a + b; return s >= m ? s - m : s; }
+    uint64_t sub(uint64_t a, uint64_t b) const { return a >= b ? a - b : a + m - b; }
+};
+
+// Everything needed to answer F(n) mod m and L(n) mod m for one modulus.
+// Built once per modulus and kept in modular_cache.
+struct ModularContext {
+    uint64_t modulus;
+    unsigned __int128 period; // Pisano period of modulus, 0 if not computed
+    Montgomery64 montgomery;  // used when modulus is odd
+    Barrett64 barrett;        // used when modulus is even
+    
+    ModularContext(uint64_t m = 1, bool with_period = true);
+    pair<uint64_t, uint64_t> fibonacciPair(unsigned __int128 n) const; // F(n), F(n+1) mod m
+};
+
+// At most MODULAR_CACHE_ENTRIES contexts are kept, the oldest dropped first.
+// The lock is for the query server, which builds contexts on a helper thread.
+const size_t MODULAR_CACHE_ENTRIES = 1 << 16;
+map<uint64_t, ModularContext> modular_cache;
+deque<uint64_t> modular_cache_order;
+mutex modular_cache_mutex;
+const uint64_t MAX_MODULUS = (1ULL << 63) - 1;
+
+// a(n) = c1 a(n-1) + c2 a(n-2) + ... + cK a(n-K), with a(0..K-1) given.
+// The order K is fixed at compile time; DynamicRecurrence is the runtime form.
+template <size_t K>
+struct Recurrence {
+    array<long long, K> coeffs;  // c1..cK
+    array<long long, K> initial; // a(0)..a(K-1)
+};
+
+struct DynamicRecurrence {
+    vector<long long> coeffs;
+    vector<long long> initial;
+    
+    DynamicRecurrence() {}
+    template <size_t K>
+    DynamicRecurrence(const Recurrence<K>& rec)
+        : coeffs(rec.coeffs.begin(), rec.coeffs.end()), initial(rec.initial.begin(), rec.initial.end()) {}
+};
+
+constexpr Recurrence<2> FIBONACCI_RECURRENCE = {{{1, 1}}, {{0, 1}}};
+constexpr Recurrence<2> LUCAS_RECURRENCE = {{{1, 1}}, {{2, 1}}};
+constexpr Recurrence<2> PELL_RECURRENCE = {{{2, 1}}, {{0, 1}}};
+constexpr Recurrence<2> JACOBSTHAL_RECURRENCE = {{{1, 2}}, {{0, 1}}};
+constexpr Recurrence<3> TRIBONACCI_RECURRENCE = {{{1, 1, 1}}, {{0, 0, 1}}};
+
+// Rings the recurrence engine can run over: residues modulo m, or exact
+// signed big integers.
+struct ModRing {
+    typedef uint64_t Value;
+    Barrett64 arith;
+    
+    explicit ModRing(uint64_t m) : arith(m) {}
+    Value fromInt(long long v) const;
+    Value add(Value a, Value b) const { return arith.add(a, b); }
+    Value sub(Value a, Value b) const { return arith.sub(a, b); }
+    Value mul(Value a, Value b) const { return arith.mul(a, b); }
+};
+
+struct BigRing {
+    typedef SignedLimbs Value;
+    
+    Value fromInt(long long v) const;
+    Value add(const Value& a, const Value& b) const { return signed_add(a, b); }
+    Value sub(const Value& a, const Value& b) const { return signed_sub(a, b); }
+    Value mul(const Value& a, const Value& b) const { return signed_mul(a, b); }
+};
+
+// Fork-join pool with one task deque per worker. A worker pops its own
+// newest task (LIFO, cache-warm) and, when empty, steals the oldest task of
+// another worker (FIFO, usually the largest subproblem). Threads outside
+// the pool, its creator included, act as worker 0 and run tasks while they
+// wait, as does every worker blocked in wait(), so nested fork-join never
+// deadlocks.
+struct TaskGroup {
+    atomic<int> pending;
+    TaskGroup() : pending(0) {}
+};
+
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threads);
+    ~WorkStealingPool();
+    
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+    void spawn(TaskGroup& group, function<void()> task);
+    void wait(TaskGroup& group);
+    unsigned long long steals() const { return steal_count.load(memory_order_relaxed); }
+    
+private:
+    struct Task {
+        function<void()> run;
+        TaskGroup* group;
+    };
+    struct Worker {
+        mutex lock;
+        deque<Task> tasks;
+    };
+    
+    bool run_one(unsigned self);
+    void worker_loop(unsigned self);
+    unsigned self_index() const;
+    
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads;
+    atomic<bool> stopping;
+    atomic<int> queued, sleepers;
+    atomic<unsigned long long> steal_count;
+    mutex sleep_mutex;
+    condition_variable wake;
+    
+    WorkStealingPool(const WorkStealingPool&);
+    WorkStealingPool& operator=(const WorkStealingPool&);
+};
+
+// Lazy view of the terms first..last of Fibonacci or Lucas. Each call to
+// next makes up to chunk terms in the caller's vector; only that chunk and
+// the two terms that continue it are held, so a range of any length runs in
+// bounded memory. The first call seeds X(first), X(first + 1) with one
+// fast-doubling jump, so a range may start anywhere.
+class SequenceRange {
+public:
+    SequenceRange(bool lucas, long long first, long long last, size_t chunk)
+        : lucas(lucas), index(first), last(last), chunk(max<size_t>(chunk, 1)), seeded(false) {}
+    
+    bool next(vector<BigInt>& terms); // false once the range is exhausted
+    long long position() const { return index; } // index of the next term
+    
+private:
+    bool lucas;
+    long long index, last;
+    size_t chunk;
+    bool seeded;
+    BigInt current, following; // X(index), X(index + 1) once seeded
+};
+
+// One sequence as seen by the calculator menus. The recurrence drives the
+// generic engine; the function pointers, when set, are specialised engines
+// that take its place (Fibonacci and Lucas have their own fast doubling).
+struct SequenceSpec {
+    string name;
+    string symbol;
+    DynamicRecurrence recurrence;
+    int max_64bit_index; // last index that fits in long long, -1 if unknown
+    long long (*iterative)(int);
+    long long (*recursive)(int);
+    long long (*parallel_recursive)(int, WorkStealingPool&, int);
+    long long (*memoized)(int);
+    SharedMemo* memo;
+    long long (*fast_doubling)(int);
+    BigInt (*big)(long long);
+    TermValue (*term)(long long);
+    SequenceRange (*range)(long long, long long);
+    uint64_t (*modular)(unsigned long long, uint64_t);
+};
+
+// One line of batch input. modulus == 0 means the exact value is wanted.
+struct BatchQuery {
+    uint64_t n;
+    uint64_t modulus;
+    bool lucas;
+    bool valid;
+};
+
+// One independent F(n), F(n+1) mod m evaluation for the lane kernels. Lanes
+// use 32-bit Montgomery arithmetic, so modulus must be odd and below 2^31.
+struct LaneJob {
+    uint64_t n;
+    uint32_t modulus;
+    uint64_t f, f1; // results
+};
+
+// Answer to one batch query: a 64-bit value, or (text >= 0) an index into the
+// list of textual answers used for big-integer results and errors.
+struct BatchResult {
+    uint64_t value;
+    int text;
+};
+
+// One method in a benchmark suite: run(n) is timed over every n in sizes and
+// the timings are checked against the claimed growth (a COMPLEXITY_MODELS name).
+struct BenchmarkCase {
+    string method;
+    string claimed;
+    long long (*run)(int);
+    vector<int> sizes;
+};
+
+// Timing statistics for one n, in nanoseconds per call
+struct BenchmarkPoint {
+    int n;
+    int samples;
+    long long iterations; // calls per sample
+    double median, p99, mean, stddev;
+};
+
+struct BenchmarkResult {
+    string suite;
+    string method;
+    string claimed;
+    string fitted;   // best-fitting model
+    double slope;    // log-log slope of median time against n
+    vector<BenchmarkPoint> points;
+};
+
+// Growth model for complexity fitting, as log g(n)
+struct ComplexityModel {
+    const char* name;
+    double (*log_growth)(double);
+};
 
 // All function declarations
 void mainMenu();
 void clearScreen();
 
+// Sequence calculator (shared by every linear recurrence)
+void sequenceCalculator(const SequenceSpec& spec);
+void compareMethods(const SequenceSpec& spec, int n);
+void printParallelScaling(const SequenceSpec& spec, int n);
+void recurrenceCalculator();
+bool readCustomRecurrence(DynamicRecurrence& rec);
+string describeRecurrence(const SequenceSpec& spec);
+SequenceSpec fibonacci_spec();
+SequenceSpec lucas_spec();
+SequenceSpec generic_spec(const string& name, const string& symbol, const DynamicRecurrence& rec);
+
+// Linear recurrence engine
+template <class Ring, class Rec>
+typename Ring::Value recurrence_term(const Rec& rec, unsigned long long n, const Ring& ring);
+template <class Ring, class Rec>
+vector<typename Ring::Value> recurrence_sequence(const Rec& rec, int n, const Ring& ring);
+template <class Ring, class Rec>
+typename Ring::Value recurrence_stepped_term(const Rec& rec, int n, const Ring& ring);
+const int STEPPING_MAX_N = 100000; // largest n Compare checks by linear stepping
+template <class Ring>
+vector<typename Ring::Value> poly_mul(const vector<typename Ring::Value>& a,
+                                      const vector<typename Ring::Value>& b, const Ring& ring);
+
 // Fibonacci Sequence functions
 void fibonacciCalculator();
 long long fibonacci_iterative(int n);
 long long fibonacci_recursive(int n);
-long long fibonacci_memoized(int n, vector<long long>& memo);
-vector<long long> fibonacci_sequence(int n);
+long long fibonacci_recursive_parallel(int n, WorkStealingPool& pool, int cutoff);
+long long fibonacci_memoized(int n);
+long long fibonacci_fast_doubling(int n);
+BigInt fibonacci_big(long long n);
+TermValue fibonacci_term(long long n);
+vector<BigInt> fibonacci_sequence(int n);
+SequenceRange fibonacci_range(long long first, long long last);
 
 // Lucas Sequence functions
 void lucasCalculator();
 long long lucas_iterative(int n);
 long long lucas_recursive(int n);
-long long lucas_memoized(int n, vector<long long>& memo);
-vector<long long> lucas_sequence(int n);
+long long lucas_recursive_parallel(int n, WorkStealingPool& pool, int cutoff);
+long long lucas_memoized(int n);
+long long lucas_fast_doubling(int n);
+BigInt lucas_big(long long n);
+TermValue lucas_term(long long n);
+vector<BigInt> lucas_sequence(int n);
+SequenceRange lucas_range(long long first, long long last);
+
+// Fast doubling engine (shared by Fibonacci and Lucas)
+const size_t BIG_DISPLAY_LIMIT_BITS = 1 << 20; // larger terms are summarised on screen
+pair<long long, long long> fibonacci_lucas_pair(int n);
+void fibonacci_lucas_big(long long n, BigInt& f, BigInt& l);
+bool fibonacci_lucas_wide(long long n, bool want_lucas, unsigned __int128& result);
+TermValue dispatch_term(long long n, bool lucas);
+void fibonacci_lucas_add(BigInt& f, BigInt& l, const BigInt& fd, const BigInt& ld);
+
+// Precomputed term store (--build-store writes it, startup maps it)
+const char* const TERM_STORE_DEFAULT_PATH = "dm_terms.bin";
+const uint32_t STORE_MIN_LEVEL = 10;   // no checkpoints below 2^10
+const uint32_t STORE_PER_LEVEL = 16;   // checkpoints k * 2^j, k = 1..16
+const uint32_t STORE_PISANO_MODULI = 1 << 16;
+void open_default_term_store();
+int runBuildStore(const char* path, unsigned long long max_n);
+bool build_term_store(const string& path, unsigned long long max_n, string& error);
+
+// Sequence ranges and their ordered parallel export (--sequence)
+const size_t SEQUENCE_CHUNK_TERMS = 1 << 10; // most terms per SequenceRange::next
+const size_t SEQUENCE_BLOCK_BYTES = 1 << 22; // text per export block, roughly
+size_t sequence_block_terms(long long last);
+bool write_sequence_range(const SequenceSpec& spec, long long first, long long last, unsigned threads, FILE* out);
+int runSequenceExport(const string& sequence, long long first, long long last, unsigned threads);
+
+// Big integer arithmetic
+void limbs_trim(Limbs& a);
+int limbs_compare(const Limbs& a, const Limbs& b);
+Limbs limbs_add(const Limbs& a, const Limbs& b);
+Limbs limbs_sub(const Limbs& a, const Limbs& b);
+void limbs_add_shifted(Limbs& acc, const Limbs& x, size_t shift);
+uint32_t limbs_divmod_small(Limbs& a, uint32_t d);
+Limbs limbs_divmod(const Limbs& a, const Limbs& b, Limbs& remainder);
+Limbs limbs_isqrt(const Limbs& a);
+bool parse_big(const string& text, BigInt& value);
+Limbs limbs_mul(const Limbs& a, const Limbs& b);
+Limbs limbs_mul_schoolbook(const Limbs& a, const Limbs& b);
+Limbs limbs_mul_karatsuba(const Limbs& a, const Limbs& b);
+Limbs limbs_mul_toom3(const Limbs& a, const Limbs& b);
+Limbs limbs_mul_ntt(const Limbs& a, const Limbs& b);
+void printBigTerm(const string& label, const BigInt& value, bool negative = false);
+bool save_big_term(const string& path, const BigInt& value, bool hex, string& error);
+int runTermToFile(const string& sequence, long long n, const string& path, bool hex);
+
+// Radix conversion: decimal output splits by cached powers 10^(9 * 2^k)
+const size_t DECIMAL_THRESHOLD = 64;     // limbs converted by peeling 10^9 chunks
+const size_t RECIPROCAL_THRESHOLD = 128; // divisor limbs below which Knuth division wins
+void limbs_append_decimal(const Limbs& a, string& out);
+Limbs limbs_reciprocal(const Limbs& d);
+shared_ptr<const DecimalPower> decimal_power(size_t level);
+
+// Number-theoretic transform over the prime 2^64 - 2^32 + 1 ("Goldilocks"):
+// 16-bit digits keep every convolution sum below the prime for operands up
+// to 2^32 digits, and 2^32 divides p - 1, so transforms up to that length
+// exist. Butterflies of large stages are split into tasks on one pool shared
+// by every multiplication in the process.
+const uint64_t NTT_PRIME = 0xffffffff00000001ULL;
+const uint64_t NTT_GENERATOR = 7;
+const size_t NTT_THRESHOLD = 1 << 12; // limbs of the smaller operand
+const size_t NTT_BLOCK = 1 << 12;     // elements per task; smaller stages stay inside one
+uint64_t ntt_mul(uint64_t a, uint64_t b);
+uint64_t ntt_pow(uint64_t base, uint64_t exp);
+shared_ptr<const vector<uint64_t>> ntt_roots(size_t n);
+WorkStealingPool& ntt_pool();
+void ntt_forward(vector<uint64_t>& a, const vector<uint64_t>& roots, WorkStealingPool& pool);
+void ntt_inverse(vector<uint64_t>& a, const vector<uint64_t>& roots, WorkStealingPool& pool);
+void ntt_parallel(WorkStealingPool& pool, size_t count, size_t grain, const function<void(size_t, size_t)>& body);
+
+// Modular queries and Pisano periods
+void modularTermQuery(const SequenceSpec& spec);
+ModularContext modular_context(uint64_t m);
+bool find_modular_context(uint64_t m, ModularContext& context);
+void store_modular_context(const ModularContext& context);
+uint64_t fibonacci_mod(unsigned long long n, uint64_t m);
+uint64_t lucas_mod(unsigned long long n, uint64_t m);
+unsigned __int128 pisano_period(uint64_t m);
+unsigned __int128 pisano_period_prime(uint64_t p);
+template <class Arith>
+pair<uint64_t, uint64_t> fibonacci_pair_mod(unsigned __int128 n, const Arith& arith);
+
+// Batch mode
+int runCommandLine(int argc, char* argv[]);
+void printUsage(const char* program);
+int runBatch(const char* path);
+bool readAllInput(const char* path, string& input);
+vector<BatchQuery> parseBatchQueries(const string& input);
+vector<BatchResult> evaluateBatch(const vector<BatchQuery>& queries, vector<string>& texts,
+                                  vector<uint64_t>* unknown_moduli = 0);
+
+// Query server (--serve): epoll loop over a Unix or localhost TCP socket
+const size_t SERVER_CACHE_ENTRIES = 1 << 16;
+const size_t SERVER_CACHE_BYTES = 64 << 20;
+const uint64_t SERVER_MAX_EXACT_N = 100000; // exact terms are computed on the event loop
+const size_t SERVER_MAX_LINE = 4096;
+const size_t SERVER_MAX_OUTPUT = 1 << 20;  // unsent bytes past which a client is not read
+const size_t SERVER_MAX_INPUT = 1 << 16;   // unparsed bytes past which a client is not read
+const size_t SERVER_MAX_PIPELINE = 64;     // requests taken from one client per wakeup
+const size_t SERVER_PISANO_QUEUE = 1024;   // new moduli waiting for their Pisano period
+const int SERVER_MAX_HANOI_DISKS = 100000;
+int runServer(const string& address);
+string answer_hanoi_query(const string& line);
+string normalise_query(const BatchQuery& query);
+
+// SIMD lane kernels
+const uint32_t LANE_MAX_MODULUS = (1U << 31) - 1;
+const char* lane_kernel_name();
+void fibonacci_pairs_mod_lanes(vector<LaneJob>& jobs);
+void fibonacci_pairs_mod_scalar(LaneJob* jobs, size_t count);
+#ifdef DM_HAVE_X86_SIMD
+void fibonacci_pairs_mod_avx2(LaneJob* jobs, size_t count);
+void fibonacci_pairs_mod_avx512(LaneJob* jobs, size_t count);
+#endif
+
+// Number theory helpers
+uint64_t mulmod_u64(uint64_t a, uint64_t b, uint64_t m);
+uint64_t powmod_u64(uint64_t base, uint64_t exp, uint64_t m);
+bool is_prime_u64(uint64_t n);
+uint64_t pollard_rho(uint64_t n);
+vector<pair<uint64_t, int>> factorize(uint64_t n);
+unsigned __int128 gcd_u128(unsigned __int128 a, unsigned __int128 b);
+string u128_to_string(unsigned __int128 value);
+
+// Lucas sequences U_n(P, Q), V_n(P, Q) and Baillie-PSW primality testing
+const size_t PRIME_BATCH_CHUNK_BYTES = 1 << 18; // input per work unit in --primes
+const uint64_t PRIME_SCAN_BLOCK = 1 << 14;
+void primalityMenu();
+void lucasSequenceQuery();
+void primalityTestQuery();
+void primeRangeScan();
+pair<uint64_t, uint64_t> lucas_uv_mod(unsigned long long n, long long p, long long q, uint64_t m);
+template <class Arith>
+typename Arith::Value arith_int(const Arith& arith, long long x);
+template <class Arith>
+pair<typename Arith::Value, typename Arith::Value> lucas_u_pair(unsigned long long n, long long p, long long q,
+                                                                const Arith& arith);
+template <class Arith, class Exponent>
+void lucas_uv_ladder(const Arith& arith, const Exponent& n, long long p, long long q,
+                     typename Arith::Value& u, typename Arith::Value& v, typename Arith::Value& qk);
+template <class Arith, class Exponent>
+bool strong_probable_prime_base2(const Arith& arith, const Exponent& d, int s);
+template <class Arith, class Exponent>
+bool strong_lucas_probable_prime(const Arith& arith, const Exponent& d, int s, long long discriminant);
+template <class Number>
+long long selfridge_discriminant(const Number& n);
+int jacobi_symbol(long long a, uint64_t n);
+int jacobi_symbol(long long a, const BigInt& n);
+bool is_square(uint64_t n);
+bool is_square(const BigInt& n);
+bool is_prime_bpsw(uint64_t n);
+bool is_prime_bpsw(const BigInt& n);
+int runPrimeBatch(const char* path, unsigned threads);
+size_t test_prime_lines(const char* begin, const char* end, string& out);
+
+// Fibonacci coding: v is written as the Zeckendorf digits of v + 1, lowest
+// first, then a 1, so the only "11" in a code word is at its end
+const int FIBONACCI_CODE_TERMS = 92;       // F(2)..F(93), the terms below 2^64
+const uint64_t FIBONACCI_SMALL_VALUES = 1 << 12; // values encoded by table lookup
+const size_t CODEC_BENCH_VALUES = 1 << 22;       // values per distribution
+void fibonacciCodingMenu();
+const FibonacciCodeTables& fibonacci_code_tables();
+vector<int> zeckendorf(uint64_t n);
+void fibonacci_encode(uint64_t value, BitWriter& out);
+bool fibonacci_decode(BitReader& in, uint64_t& value);
+size_t fibonacci_decode_fast(BitReader& in, uint64_t* values, size_t count);
+void varint_encode(uint64_t value, vector<uint8_t>& out);
+size_t varint_decode(const vector<uint8_t>& in, uint64_t* values, size_t count);
+int runCodecBenchmark(size_t count);
 
 // Tower of Hanoi functions
 void towerOfHanoi();
 void tower_of_hanoi_recursive(int n, char from, char to, char aux, int& step);
 void tower_of_hanoi_iterative(int n);
+void streamHanoiMoves(int n);
+void hanoiRandomAccessQuery(int n, int choice);
+
+void tower_of_hanoi_fill(int n, int from, int to, int aux, HanoiMove* out);
+void tower_of_hanoi_parallel(int n, int from, int to, int aux, HanoiMove* out, WorkStealingPool& pool, int cutoff);
+void compareHanoiParallel(int n);
+
+// Random-access queries on the optimal 3-peg solution (n <= 127 disks)
+typedef unsigned __int128 MoveCount;
+const int HANOI_MAX_WIDE_DISKS = 127;
+const int HANOI_MAX_EXACT_DISKS = 100000; // larger counts are printed approximately
+MoveCount hanoi_move_count(int n);
+string hanoi_move_count_string(int n);
+HanoiMove hanoi_kth_move(int n, MoveCount k);
+vector<int> hanoi_configuration(int n, MoveCount k);
+bool hanoi_move_index(const vector<int>& config, MoveCount& k);
+bool parse_u128(const string& text, MoveCount& value);
+
+// Multi-peg Frame-Stewart solver (3-10 pegs)
+const int MULTIPEG_MAX_DISKS = 1000;
+const int MULTIPEG_MAX_PEGS = 10;
+void multiPegHanoi(int n);
+shared_ptr<const FrameStewartTable> frame_stewart_table(int disks, int pegs);
+void build_frame_stewart(FrameStewartTable& table, WorkStealingPool& pool);
+void frame_stewart_cell(FrameStewartTable& table, int n, int p);
+MoveCount frame_stewart_moves(int disks, int pegs);
+
+// Shortest solutions between arbitrary configurations (config[i] is the peg
+// of disk i + 1): O(n) rule for 3 pegs, bidirectional search for 4 pegs
+const int HANOI_SEARCH_MAX_DISKS = 13; // 4^13 states, 16 MB visited table per side
+void solveConfigurationMenu(int n);
+bool read_configuration(int n, int pegs, const string& rods, vector<int>& config);
+MoveCount hanoi_gather_count(const vector<int>& config, int m, int target);
+void hanoi_gather(const vector<int>& config, int m, int target, vector<HanoiMove>& out);
+void hanoi_tower(int m, int from, int to, vector<HanoiMove>& out);
+MoveCount hanoi_distance(const vector<int>& start, const vector<int>& goal, bool& twice);
+vector<HanoiMove> hanoi_solve(const vector<int>& start, const vector<int>& goal);
+bool hanoi_search(const vector<int>& start, const vector<int>& goal, int pegs, vector<HanoiMove>& path);
+void hanoi_neighbours(uint32_t state, int n, int pegs, vector<uint32_t>& out);
+vector<uint32_t> hanoi_walk_back(const DistanceTable& table, uint32_t state, uint32_t root, int n, int pegs);
+
+// Solution validator on the packed peg simulator
+void validateHanoiMenu(int n);
+template <class Source>
+uint64_t validate_moves(PegSimulator& sim, Source& source, HanoiMove& bad, bool& legal);
+void printValidation(const PegSimulator& sim, uint64_t applied, bool legal, const HanoiMove& bad,
+                     int target, double seconds);
+int runValidation(const char* path, int disks, int pegs);
+
+// Parallel export of a full solution into a memory-mapped file
+const size_t HANOI_TEXT_RECORD = 7;   // "DD F T\n"
+const size_t HANOI_BINARY_RECORD = 2; // disk, from << 4 | to
+const size_t HANOI_BINARY_HEADER = 16;
+void exportHanoiMenu(int n);
+bool export_hanoi_moves(int n, const string& path, bool binary, unsigned threads, string& error);
+void write_hanoi_chunk(int n, uint64_t first, uint64_t last, bool binary, char* out);
 void display_towers(int n, const vector<stack<int>>& rods);
 
-// Efficiency Calculator functions
+// Work-stealing pool
+const int DEFAULT_PARALLEL_CUTOFF = 20;
+int parallel_cutoff();
+vector<unsigned> scaling_thread_counts();
+
+// Instrumentation report
+void instrumentationReport();
+void reset_probes();
+
+// Efficiency Calculator functions (empirical benchmark harness)
+const int BENCH_WARMUP_RUNS = 3;
+const int BENCH_SAMPLES = 25;
+const double BENCH_MIN_SAMPLE_NS = 200000; // repeat fast calls until a sample lasts this long
+const double BENCH_FIT_TOLERANCE = 0.10;   // relative rms error treated as timing noise
 int efficiencyCalculator();
-void measureFibonacciTime();
-void measureLucasTime();
-void measureHanoiTime();
+vector<BenchmarkResult> measureFibonacciTime();
+vector<BenchmarkResult> measureLucasTime();
+vector<BenchmarkResult> measureHanoiTime();
+vector<BenchmarkResult> run_benchmark_suite(const string& suite, const vector<BenchmarkCase>& cases, ostream& progress);
+BenchmarkResult run_benchmark(const string& suite, const BenchmarkCase& bench, ostream& progress);
+BenchmarkPoint benchmark_point(int n, long long iterations, vector<double>& samples);
+void fit_complexity(BenchmarkResult& result);
+vector<BenchmarkCase> fibonacci_benchmarks();
+vector<BenchmarkCase> lucas_benchmarks();
+vector<BenchmarkCase> hanoi_benchmarks();
+void printBenchmarkResults(const vector<BenchmarkResult>& results);
+void saveBenchmarkResults(const vector<BenchmarkResult>& results);
+void write_benchmark_json(ostream& out, const vector<BenchmarkResult>& results);
+void write_benchmark_csv(ostream& out, const vector<BenchmarkResult>& results);
+int runBenchmarks(const string& suite, const string& format, const char* path);
+long long bench_fibonacci_mod(int n);
+long long bench_lucas_mod(int n);
+long long bench_fibonacci_big(int n);
+long long bench_lucas_big(int n);
+long long bench_hanoi_recursive(int n);
+long long bench_hanoi_generator(int n);
+long long bench_hanoi_kth_move(int n);
+long long bench_hanoi_configuration(int n);
 
 // Graph Visualizer functions
+const long long PLOT_MAX_N = 10000000;
 void graphVisualizer();
-void printFibonacciGraph(int n);
-void printLucasGraph(int n);
-void printHanoiGraph(int n);
+PlotData make_plot(const string& title, const string& y_label, long long first, long long last, int columns, bool log_x);
+void plot_add(PlotData& plot, long long n, double y);
+void plot_curve(PlotData& plot, double (*value)(long long));
+void plot_timing(PlotData& plot, int samples);
+double fibonacci_log10(long long n);
+double lucas_log10(long long n);
+double hanoi_log10(long long n);
+double golden_ratio_error_log10(long long n);
+void printPlot(const PlotData& plot, int rows);
+bool write_plot_svg(const PlotData& plot, const string& path);
+bool write_plot_ppm(const PlotData& plot, const string& path, int height);
 
 // Utility functions
 void pressEnterToContinue();
 void displayHeader(const string& title);
 
-int main() {
+int main(int argc, char* argv[]) {
+    open_default_term_store();
+    if (argc > 1) return runCommandLine(argc, argv);
+    
     int input;
     do {
         clearScreen();
@@ -78,6 +1182,12 @@ int main() {
             case 5:
                 graphVisualizer();
                 break;
+            case 6:
+                recurrenceCalculator();
+                break;
+            case 7:
+                primalityMenu();
+                break;
             default:
                 cout << "Invalid choice! Please try again." << endl;
                 pressEnterToContinue();
@@ -118,25 +1228,202 @@ void mainMenu() {
     cout << "3. Tower Of Hanoi Step Calculator" << endl;
     cout << "4. Time and Space Complexity Calculator" << endl;
     cout << "5. Visual Graphs" << endl;
+    cout << "6. Other Linear Recurrences (Pell, Jacobsthal, Tribonacci, custom)" << endl;
+    cout << "7. Lucas Sequences U/V(P, Q) and Primality Testing" << endl;
     cout << "0. End Program" << endl;
     cout << "Enter your choice: ";
 }
 
 // ========== FIBONACCI CALCULATOR ==========
 void fibonacciCalculator() {
+    sequenceCalculator(fibonacci_spec());
+}
+
+SequenceSpec fibonacci_spec() {
+    SequenceSpec spec = generic_spec("Fibonacci", "F", FIBONACCI_RECURRENCE);
+    spec.max_64bit_index = 92;
+    spec.iterative = fibonacci_iterative;
+    spec.recursive = fibonacci_recursive;
+    spec.parallel_recursive = fibonacci_recursive_parallel;
+    spec.memoized = fibonacci_memoized;
+    spec.memo = &fibonacci_memo;
+    spec.fast_doubling = fibonacci_fast_doubling;
+    spec.big = fibonacci_big;
+    spec.term = fibonacci_term;
+    spec.range = fibonacci_range;
+    spec.modular = fibonacci_mod;
+    return spec;
+}
+
+long long fibonacci_iterative(int n) {
+    if (n <= 1) return n;
+    
+    long long a = 0, b = 1;
+    for (int i = 2; i <= n; i++) {
+        long long next = a + b;
+        a = b;
+        b = next;
+    }
+    return b;
+}
+
+long long fibonacci_recursive(int n) {
+    DM_PROBE(PROBE_FIBONACCI_RECURSIVE);
+    if (n <= 1) return n;
+    return fibonacci_recursive(n-1) + fibonacci_recursive(n-2);
+}
+
+// Forks F(n-1), computes F(n-2) itself, then joins; below the cutoff the
+// plain recursion runs so task overhead stays small next to the work.
+long long fibonacci_recursive_parallel(int n, WorkStealingPool& pool, int cutoff) {
+    if (n <= cutoff) return fibonacci_recursive(n);
+    long long left = 0;
+    TaskGroup group;
+    pool.spawn(group, [&]() { left = fibonacci_recursive_parallel(n - 1, pool, cutoff); });
+    long long right = fibonacci_recursive_parallel(n - 2, pool, cutoff);
+    pool.wait(group);
+    return left + right;
+}
+
+long long fibonacci_memoized(int n) {
+    return fibonacci_memo.get(n);
+}
+
+long long fibonacci_fast_doubling(int n) {
+    if (n < 0) return -1;
+    return fibonacci_lucas_pair(n).first;
+}
+
+BigInt fibonacci_big(long long n) {
+    BigInt f, l;
+    fibonacci_lucas_big(n, f, l);
+    return f;
+}
+
+TermValue fibonacci_term(long long n) {
+    return dispatch_term(n, false);
+}
+
+vector<BigInt> fibonacci_sequence(int n) {
+    vector<BigInt> sequence;
+    if (n >= 0) SequenceRange(false, 0, n, n + 1).next(sequence);
+    return sequence;
+}
+
+SequenceRange fibonacci_range(long long first, long long last) {
+    return SequenceRange(false, first, last, SEQUENCE_CHUNK_TERMS);
+}
+
+// ========== LUCAS CALCULATOR ==========
+void lucasCalculator() {
+    sequenceCalculator(lucas_spec());
+}
+
+SequenceSpec lucas_spec() {
+    SequenceSpec spec = generic_spec("Lucas", "L", LUCAS_RECURRENCE);
+    spec.max_64bit_index = 90;
+    spec.iterative = lucas_iterative;
+    spec.recursive = lucas_recursive;
+    spec.parallel_recursive = lucas_recursive_parallel;
+    spec.memoized = lucas_memoized;
+    spec.memo = &lucas_memo;
+    spec.fast_doubling = lucas_fast_doubling;
+    spec.big = lucas_big;
+    spec.term = lucas_term;
+    spec.range = lucas_range;
+    spec.modular = lucas_mod;
+    return spec;
+}
+
+long long lucas_iterative(int n) {
+    if (n < 0) return -1;
+    if (n == 0) return 2;
+    if (n == 1) return 1;
+    
+    long long a = 2, b = 1;
+    for (int i = 2; i <= n; i++) {
+        long long next = a + b;
+        a = b;
+        b = next;
+    }
+    return b;
+}
+
+long long lucas_recursive(int n) {
+    DM_PROBE(PROBE_LUCAS_RECURSIVE);
+    if (n < 0) return -1;
+    if (n == 0) return 2;
+    if (n == 1) return 1;
+    return lucas_recursive(n-1) + lucas_recursive(n-2);
+}
+
+long long lucas_recursive_parallel(int n, WorkStealingPool& pool, int cutoff) {
+    if (n <= cutoff) return lucas_recursive(n);
+    long long left = 0;
+    TaskGroup group;
+    pool.spawn(group, [&]() { left = lucas_recursive_parallel(n - 1, pool, cutoff); });
+    long long right = lucas_recursive_parallel(n - 2, pool, cutoff);
+    pool.wait(group);
+    return left + right;
+}
+
+long long lucas_memoized(int n) {
+    return lucas_memo.get(n);
+}
+
+long long lucas_fast_doubling(int n) {
+    if (n < 0) return -1;
+    return fibonacci_lucas_pair(n).second;
+}
+
+BigInt lucas_big(long long n) {
+    BigInt f, l;
+    fibonacci_lucas_big(n, f, l);
+    return l;
+}
+
+TermValue lucas_term(long long n) {
+    return dispatch_term(n, true);
+}
+
+vector<BigInt> lucas_sequence(int n) {
+    vector<BigInt> seq;
+    if (n >= 0) SequenceRange(true, 0, n, n + 1).next(seq);
+    return seq;
+}
+
+SequenceRange lucas_range(long long first, long long last) {
+    return SequenceRange(true, first, last, SEQUENCE_CHUNK_TERMS);
+}
+
+// ========== SEQUENCE CALCULATOR ==========
+void sequenceCalculator(const SequenceSpec& spec) {
+    string title = spec.name + " SEQUENCE CALCULATOR";
+    transform(title.begin(), title.end(), title.begin(), ::toupper);
+    
     int choice;
     do {
         clearScreen();
-        displayHeader("FIBONACCI SEQUENCE CALCULATOR");
+        displayHeader(title);
         
+        cout << describeRecurrence(spec) << endl << endl;
         cout << "1. Calculate single term" << endl;
         cout << "2. Display sequence up to nth term" << endl;
-        cout << "3. Compare iterative vs recursive vs memoized" << endl;
+        if (spec.fast_doubling) {
+            cout << "3. Compare fast doubling vs iterative vs recursive vs memoized" << endl;
+        } else {
+            cout << "3. Compare recurrence engine vs linear stepping" << endl;
+        }
+        cout << "4. Calculate single term modulo m" << endl;
         cout << "0. Back to main menu" << endl;
         cout << "Enter your choice: ";
         cin >> choice;
         
         if (choice == 0) break;
+        if (choice == 4) {
+            modularTermQuery(spec);
+            continue;
+        }
         
         int n;
         cout << "Enter term position (starting from 0): ";
@@ -148,54 +1435,66 @@ void fibonacciCalculator() {
             continue;
         }
         
-        vector<long long> memo_vec(n + 1, -1);
-        
         switch(choice) {
             case 1: {
-                cout << "\nFibonacci(" << n << ") = " << fibonacci_iterative(n) << endl;
+                string label = spec.name + "(" + to_string(n) + ")";
+                auto start = high_resolution_clock::now();
+                cout << endl;
+                if (spec.term) {
+                    TermValue value = spec.term(n);
+                    if (value.tier == TermValue::BIG) printBigTerm(label, value.big);
+                    else cout << label << " = " << value.toString() << endl;
+                    cout << "Representation: " << value.tierName() << endl;
+                    if (value.tier == TermValue::BIG && value.big.bitLength() > BIG_DISPLAY_LIMIT_BITS) {
+                        string path, error;
+                        cout << "Save every digit to a file? Enter a path (- to skip): ";
+                        cin >> path;
+                        if (path != "-") {
+                            if (save_big_term(path, value.big, false, error)) cout << "Written to " << path << endl;
+                            else cout << "Error: " << error << endl;
+                        }
+                    }
+                } else {
+                    SignedLimbs value = recurrence_term(spec.recurrence, n, BigRing());
+                    BigInt magnitude;
+                    magnitude.limbs = value.mag;
+                    printBigTerm(label, magnitude, value.neg);
+                }
+                auto elapsed = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+                cout << "Computed in " << elapsed.count() << " ms" << endl;
                 pressEnterToContinue();
                 break;
             }
             case 2: {
-                vector<long long> seq = fibonacci_sequence(n);
-                cout << "\nFibonacci sequence up to term " << n << ":" << endl;
+                long long first = 0;
+                if (spec.range) {
+                    cout << "Start from term (0 for the beginning): ";
+                    cin >> first;
+                    if (first < 0 || first > n) {
+                        cout << "Error: Start must be between 0 and " << n << "!" << endl;
+                        pressEnterToContinue();
+                        break;
+                    }
+                }
+                cout << "\n" << spec.name << " sequence from term " << first << " to " << n << ":" << endl;
                 cout << string(30, '-') << endl;
-                for (int i = 0; i <= n; i++) {
-                    cout << "F(" << i << ") = " << seq[i] << endl;
+                if (spec.range) {
+                    write_sequence_range(spec, first, n, max(1u, thread::hardware_concurrency()), stdout);
+                } else {
+                    OutputBuffer listing(stdout);
+                    vector<SignedLimbs> seq = recurrence_sequence(spec.recurrence, n, BigRing());
+                    for (int i = 0; i <= n; i++) {
+                        BigInt magnitude;
+                        magnitude.limbs = seq[i].mag;
+                        listing << spec.symbol << '(' << i << ") = " << (seq[i].neg ? "-" : "") << magnitude << '\n';
+                    }
+                    listing.flush();
                 }
                 pressEnterToContinue();
                 break;
             }
             case 3: {
-                if (n > 40) {
-                    cout << "Warning: Recursive method will be slow for n > 40!" << endl;
-                    cout << "Continue anyway? (1=Yes, 0=No): ";
-                    int continue_choice;
-                    cin >> continue_choice;
-                    if (!continue_choice) break;
-                }
-                
-                cout << "\n" << string(40, '-') << endl;
-                cout << "COMPARISON OF METHODS" << endl;
-                cout << string(40, '-') << endl;
-                
-                // Iterative
-                cout << "Iterative method:" << endl;
-                cout << "Fibonacci(" << n << ") = " << fibonacci_iterative(n) << endl;
-                
-                // Recursive (only if n is small)
-                if (n <= 30) {
-                    cout << "\nRecursive method:" << endl;
-                    cout << "Fibonacci(" << n << ") = " << fibonacci_recursive(n) << endl;
-                } else {
-                    cout << "\nRecursive method: Skipped (too large for n > 30)" << endl;
-                }
-                
-                // Memoized
-                cout << "\nMemoized method:" << endl;
-                cout << "Fibonacci(" << n << ") = " << fibonacci_memoized(n, memo_vec) << endl;
-                
-                cout << string(40, '-') << endl;
+                compareMethods(spec, n);
                 pressEnterToContinue();
                 break;
             }
@@ -206,435 +1505,5981 @@ void fibonacciCalculator() {
     } while(choice != 0);
 }
 
-long long fibonacci_iterative(int n) {
-    if (n <= 1) return n;
+void compareMethods(const SequenceSpec& spec, int n) {
+    if (spec.recursive && n > 40 && n <= spec.max_64bit_index) {
+        cout << "Warning: Recursive method will be slow for n > 40!" << endl;
+        cout << "Continue anyway? (1=Yes, 0=No): ";
+        int continue_choice;
+        cin >> continue_choice;
+        if (!continue_choice) return;
+    }
     
-    long long a = 0, b = 1;
-    for (int i = 2; i <= n; i++) {
-        long long next = a + b;
-        a = b;
-        b = next;
+    cout << "\n" << string(40, '-') << endl;
+    cout << "COMPARISON OF METHODS" << endl;
+    cout << string(40, '-') << endl;
+    
+    string label = spec.name + "(" + to_string(n) + ")";
+    SignedLimbs generic = recurrence_term(spec.recurrence, n, BigRing());
+    BigInt magnitude;
+    magnitude.limbs = generic.mag;
+    
+    if (!spec.fast_doubling) {
+        // Recurrence engine
+        cout << "Recurrence engine (Bostan-Mori, default):" << endl;
+        printBigTerm(label, magnitude, generic.neg);
+        
+        // Linear stepping (reference), quadratic in n so only for moderate n
+        if (n <= STEPPING_MAX_N) {
+            SignedLimbs stepped = recurrence_stepped_term(spec.recurrence, n, BigRing());
+            BigInt stepped_magnitude;
+            stepped_magnitude.limbs = stepped.mag;
+            cout << "\nLinear stepping (reference):" << endl;
+            printBigTerm(label, stepped_magnitude, stepped.neg);
+        } else {
+            cout << "\nLinear stepping: Skipped (too large for n > " << STEPPING_MAX_N << ")" << endl;
+        }
+        cout << string(40, '-') << endl;
+        return;
     }
-    return b;
+    
+    // Past the 64-bit limit the long long methods only return wrapped values
+    if (n > spec.max_64bit_index) {
+        cout << "Fast doubling, iterative, recursive and memoized methods: overflow (past "
+             << spec.symbol << "(" << spec.max_64bit_index << "), skipped)" << endl;
+        cout << "\nExact big-integer value:" << endl;
+        printBigTerm(label, spec.big(n));
+        cout << "\nGeneric recurrence engine (Bostan-Mori):" << endl;
+        printBigTerm(label, magnitude, generic.neg);
+        cout << string(40, '-') << endl;
+        return;
+    }
+    
+    // Fast doubling (default)
+    cout << "Fast doubling method (default):" << endl;
+    cout << label << " = " << spec.fast_doubling(n) << endl;
+    
+    // Iterative (reference loop)
+    cout << "\nIterative method (reference):" << endl;
+    cout << label << " = " << spec.iterative(n) << endl;
+    
+    // Recursive (only if n is small)
+    if (n <= 30) {
+        cout << "\nRecursive method:" << endl;
+        cout << label << " = " << spec.recursive(n) << endl;
+    } else {
+        cout << "\nRecursive method: Skipped (too large for n > 30)" << endl;
+    }
+    
+    // Parallel recursion on the work-stealing pool
+    if (spec.parallel_recursive && n <= 45) {
+        printParallelScaling(spec, n);
+    }
+    
+    // Memoized (shared store, persists across queries)
+    cout << "\nMemoized method:" << endl;
+    cout << label << " = " << spec.memoized(n) << endl;
+    cout << "Memo: " << spec.memo->size() << " terms stored, " << spec.memo->hits() << " hits, "
+         << spec.memo->misses() << " misses" << endl;
+    
+    // Generic recurrence engine, exact
+    cout << "\nGeneric recurrence engine (Bostan-Mori):" << endl;
+    printBigTerm(label, magnitude, generic.neg);
+    
+    cout << string(40, '-') << endl;
 }
 
-long long fibonacci_recursive(int n) {
-    if (n <= 1) return n;
-    return fibonacci_recursive(n-1) + fibonacci_recursive(n-2);
+void recurrenceCalculator() {
+    clearScreen();
+    displayHeader("LINEAR RECURRENCE CALCULATOR");
+    
+    cout << "1. Pell numbers" << endl;
+    cout << "2. Jacobsthal numbers" << endl;
+    cout << "3. Tribonacci numbers" << endl;
+    cout << "4. Custom recurrence" << endl;
+    cout << "0. Back to main menu" << endl;
+    cout << "Enter your choice: ";
+    
+    int choice;
+    cin >> choice;
+    
+    switch(choice) {
+        case 0:
+            break;
+        case 1:
+            sequenceCalculator(generic_spec("Pell", "P", PELL_RECURRENCE));
+            break;
+        case 2:
+            sequenceCalculator(generic_spec("Jacobsthal", "J", JACOBSTHAL_RECURRENCE));
+            break;
+        case 3:
+            sequenceCalculator(generic_spec("Tribonacci", "T", TRIBONACCI_RECURRENCE));
+            break;
+        case 4: {
+            DynamicRecurrence rec;
+            if (readCustomRecurrence(rec)) {
+                sequenceCalculator(generic_spec("Custom", "a", rec));
+            }
+            break;
+        }
+        default:
+            cout << "Invalid choice!" << endl;
+            pressEnterToContinue();
+    }
 }
 
-long long fibonacci_memoized(int n, vector<long long>& memo) {
-    if (n <= 1) return n;
-    if (memo[n] != -1) return memo[n];
+bool readCustomRecurrence(DynamicRecurrence& rec) {
+    const int MAX_ORDER = 64;
+    int order;
+    cout << "Enter order k (1-" << MAX_ORDER << "): ";
+    cin >> order;
+    if (!cin || order < 1 || order > MAX_ORDER) {
+        cout << "Error: Order must be between 1 and " << MAX_ORDER << "!" << endl;
+        cin.clear();
+        pressEnterToContinue();
+        return false;
+    }
     
-    memo[n] = fibonacci_memoized(n-1, memo) + fibonacci_memoized(n-2, memo);
-    return memo[n];
+    rec.coeffs.assign(order, 0);
+    rec.initial.assign(order, 0);
+    cout << "a(n) = c1 a(n-1) + ... + ck a(n-k)" << endl;
+    for (int i = 0; i < order; i++) {
+        cout << "Enter c" << i + 1 << ": ";
+        cin >> rec.coeffs[i];
+    }
+    for (int i = 0; i < order; i++) {
+        cout << "Enter a(" << i << "): ";
+        cin >> rec.initial[i];
+    }
+    return true;
 }
 
-vector<long long> fibonacci_sequence(int n) {
-    vector<long long> sequence;
-    if (n < 0) return sequence;
-    
-    sequence.push_back(0);
-    if (n >= 1) sequence.push_back(1);
+string describeRecurrence(const SequenceSpec& spec) {
+    const DynamicRecurrence& rec = spec.recurrence;
+    ostringstream text;
+    text << spec.symbol << "(n) =";
+    bool first = true;
+    for (size_t i = 0; i < rec.coeffs.size(); i++) {
+        long long c = rec.coeffs[i];
+        if (c == 0) continue;
+        if (first) text << (c < 0 ? " -" : " ");
+        else text << (c < 0 ? " - " : " + ");
+        if (c != 1 && c != -1) text << (c < 0 ? -c : c) << "*";
+        text << spec.symbol << "(n-" << i + 1 << ")";
+        first = false;
+    }
+    if (first) text << " 0";
+    for (size_t i = 0; i < rec.initial.size(); i++) {
+        text << ", " << spec.symbol << "(" << i << ") = " << rec.initial[i];
+    }
+    return text.str();
+}
+
+SequenceSpec generic_spec(const string& name, const string& symbol, const DynamicRecurrence& rec) {
+    SequenceSpec spec;
+    spec.name = name;
+    spec.symbol = symbol;
+    spec.recurrence = rec;
+    spec.max_64bit_index = -1;
+    spec.iterative = 0;
+    spec.recursive = 0;
+    spec.parallel_recursive = 0;
+    spec.memoized = 0;
+    spec.memo = 0;
+    spec.fast_doubling = 0;
+    spec.big = 0;
+    spec.term = 0;
+    spec.range = 0;
+    spec.modular = 0;
+    return spec;
+}
+
+// ========== LINEAR RECURRENCE ENGINE ==========
+// Bostan-Mori: a(n) = [x^n] P(x) / Q(x) with Q(x) = 1 - c1 x - ... - cK x^K and
+// P = A(x) Q(x) mod x^K. Multiplying through by Q(-x) makes the denominator
+// even, so each step keeps the half of P(x)Q(-x) matching the parity of n and
+// halves n, for O(M(K) log n) ring operations in total.
+template <class Ring, class Rec>
+typename Ring::Value recurrence_term(const Rec& rec, unsigned long long n, const Ring& ring) {
+    typedef typename Ring::Value Value;
+    size_t k = rec.coeffs.size();
+    if (n < k) return ring.fromInt(rec.initial[n]);
     
-    for (int i = 2; i <= n; i++) {
-        sequence.push_back(sequence[i-1] + sequence[i-2]);
+    vector<Value> q(k + 1), a(k);
+    q[0] = ring.fromInt(1);
+    for (size_t i = 0; i < k; i++) {
+        q[i + 1] = ring.fromInt(-rec.coeffs[i]);
+        a[i] = ring.fromInt(rec.initial[i]);
     }
+    vector<Value> p = poly_mul(a, q, ring);
+    p.resize(k, ring.fromInt(0));
     
-    return sequence;
+    vector<Value> q_neg(k + 1);
+    while (n > 0) {
+        for (size_t i = 0; i <= k; i++) {
+            q_neg[i] = (i % 2 == 1) ? ring.sub(ring.fromInt(0), q[i]) : q[i];
+        }
+        vector<Value> u = poly_mul(p, q_neg, ring);
+        vector<Value> v = poly_mul(q, q_neg, ring);
+        u.resize(2 * k, ring.fromInt(0));
+        v.resize(2 * k + 1, ring.fromInt(0));
+        
+        size_t parity = n & 1;
+        for (size_t i = 0; i < k; i++) p[i] = u[2 * i + parity];
+        for (size_t i = 0; i <= k; i++) q[i] = v[2 * i];
+        n >>= 1;
+    }
+    return p[0]; // Q(0) stays 1
 }
 
-// ========== LUCAS CALCULATOR ==========
-void lucasCalculator() {
-    int choice;
-    do {
-        clearScreen();
-        displayHeader("LUCAS SEQUENCE CALCULATOR");
-        
-        cout << "1. Calculate single term" << endl;
-        cout << "2. Display sequence up to nth term" << endl;
-        cout << "3. Compare iterative vs recursive vs memoized" << endl;
-        cout << "0. Back to main menu" << endl;
-        cout << "Enter your choice: ";
-        cin >> choice;
-        
-        if (choice == 0) break;
-        
-        int n;
-        cout << "Enter term position (starting from 0): ";
-        cin >> n;
-        
-        if (n < 0) {
-            cout << "Error: Position must be non-negative!" << endl;
-            pressEnterToContinue();
+// Terms a(0)..a(n) by direct stepping, the reference for the engine
+template <class Ring, class Rec>
+vector<typename Ring::Value> recurrence_sequence(const Rec& rec, int n, const Ring& ring) {
+    typedef typename Ring::Value Value;
+    size_t k = rec.coeffs.size();
+    vector<Value> seq;
+    seq.reserve(n + 1);
+    
+    for (int i = 0; i <= n; i++) {
+        if (static_cast<size_t>(i) < k) {
+            seq.push_back(ring.fromInt(rec.initial[i]));
             continue;
         }
+        Value next = ring.fromInt(0);
+        for (size_t j = 0; j < k; j++) {
+            if (rec.coeffs[j] != 0) {
+                next = ring.add(next, ring.mul(ring.fromInt(rec.coeffs[j]), seq[i - 1 - j]));
+            }
+        }
+        seq.push_back(next);
+    }
+    return seq;
+}
+
+// a(n) alone by direct stepping, keeping only the last k terms
+template <class Ring, class Rec>
+typename Ring::Value recurrence_stepped_term(const Rec& rec, int n, const Ring& ring) {
+    typedef typename Ring::Value Value;
+    size_t k = rec.coeffs.size();
+    if (static_cast<size_t>(n) < k) return ring.fromInt(rec.initial[n]);
+    
+    vector<Value> window(k); // a(i) lives in window[i % k]
+    for (size_t i = 0; i < k; i++) window[i] = ring.fromInt(rec.initial[i]);
+    for (size_t i = k; i <= static_cast<size_t>(n); i++) {
+        Value next = ring.fromInt(0);
+        for (size_t j = 0; j < k; j++) {
+            if (rec.coeffs[j] != 0) {
+                next = ring.add(next, ring.mul(ring.fromInt(rec.coeffs[j]), window[(i - 1 - j) % k]));
+            }
+        }
+        window[i % k] = next;
+    }
+    return window[n % k];
+}
+
+// Polynomial product over any ring: schoolbook for short operands,
+// Karatsuba above POLY_KARATSUBA_THRESHOLD coefficients.
+const size_t POLY_KARATSUBA_THRESHOLD = 32;
+
+template <class Ring>
+vector<typename Ring::Value> poly_mul(const vector<typename Ring::Value>& a,
+                                      const vector<typename Ring::Value>& b, const Ring& ring) {
+    typedef typename Ring::Value Value;
+    if (a.empty() || b.empty()) return vector<Value>();
+    
+    if (min(a.size(), b.size()) < POLY_KARATSUBA_THRESHOLD) {
+        vector<Value> result(a.size() + b.size() - 1, ring.fromInt(0));
+        for (size_t i = 0; i < a.size(); i++) {
+            for (size_t j = 0; j < b.size(); j++) {
+                result[i + j] = ring.add(result[i + j], ring.mul(a[i], b[j]));
+            }
+        }
+        return result;
+    }
+    
+    size_t half = max(a.size(), b.size()) / 2;
+    vector<Value> a0(a.begin(), a.begin() + min(half, a.size())), a1;
+    vector<Value> b0(b.begin(), b.begin() + min(half, b.size())), b1;
+    if (a.size() > half) a1.assign(a.begin() + half, a.end());
+    if (b.size() > half) b1.assign(b.begin() + half, b.end());
+    
+    vector<Value> sum_a = a0, sum_b = b0;
+    sum_a.resize(max(a0.size(), a1.size()), ring.fromInt(0));
+    sum_b.resize(max(b0.size(), b1.size()), ring.fromInt(0));
+    for (size_t i = 0; i < a1.size(); i++) sum_a[i] = ring.add(sum_a[i], a1[i]);
+    for (size_t i = 0; i < b1.size(); i++) sum_b[i] = ring.add(sum_b[i], b1[i]);
+    
+    vector<Value> z0 = poly_mul(a0, b0, ring);
+    vector<Value> z2 = poly_mul(a1, b1, ring);
+    vector<Value> z1 = poly_mul(sum_a, sum_b, ring);
+    for (size_t i = 0; i < z0.size(); i++) z1[i] = ring.sub(z1[i], z0[i]);
+    for (size_t i = 0; i < z2.size(); i++) z1[i] = ring.sub(z1[i], z2[i]);
+    
+    vector<Value> result(a.size() + b.size() - 1, ring.fromInt(0));
+    for (size_t i = 0; i < z0.size(); i++) result[i] = ring.add(result[i], z0[i]);
+    for (size_t i = 0; i < z1.size() && i + half < result.size(); i++) {
+        result[i + half] = ring.add(result[i + half], z1[i]);
+    }
+    for (size_t i = 0; i < z2.size(); i++) result[i + 2 * half] = ring.add(result[i + 2 * half], z2[i]);
+    return result;
+}
+
+ModRing::Value ModRing::fromInt(long long v) const {
+    uint64_t magnitude = v < 0 ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+    uint64_t r = magnitude % arith.m;
+    return (v < 0 && r != 0) ? arith.m - r : r;
+}
+
+BigRing::Value BigRing::fromInt(long long v) const {
+    uint64_t magnitude = v < 0 ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+    return SignedLimbs(BigInt(magnitude).limbs, v < 0);
+}
+
+// ========== FAST DOUBLING ENGINE ==========
+// Computes F(n) and L(n) together in O(log n) steps by walking the bits of n
+// from the top, using the identities that link the two sequences:
+//   F(2k)   = F(k) * L(k)
+//   L(2k)   = L(k)^2 - 2(-1)^k
+//   F(m+1)  = (F(m) + L(m)) / 2
+//   L(m+1)  = (5F(m) + L(m)) / 2
+// Arithmetic is done unsigned so the intermediate 5F(m) + L(m) near the top of
+// the 64-bit range does not overflow before the halving. Past F(92) and L(90)
+// the values have wrapped and the halvings give garbage, not X(n) mod 2^64.
+pair<long long, long long> fibonacci_lucas_pair(int n) {
+    unsigned long long f = 0, l = 2; // F(0), L(0)
+    int k = 0;
+    
+    for (int bit = 30; bit >= 0; bit--) {
+        // Double: k -> 2k
+        unsigned long long f2 = f * l;
+        unsigned long long l2 = (k % 2 == 0) ? l * l - 2 : l * l + 2;
+        f = f2;
+        l = l2;
+        k *= 2;
         
-        vector<long long> memo_vec(n + 1, -1);
+        // Step: 2k -> 2k + 1
+        if ((n >> bit) & 1) {
+            unsigned long long f1 = (f + l) / 2;
+            unsigned long long l1 = (5 * f + l) / 2;
+            f = f1;
+            l = l1;
+            k++;
+        }
+    }
+    return make_pair(static_cast<long long>(f), static_cast<long long>(l));
+}
+
+// Same identities as fibonacci_lucas_pair, on big integers. Each bit of n
+// costs one multiplication and one squaring; the halvings are plain shifts.
+void fibonacci_lucas_big(long long n, BigInt& f, BigInt& l) {
+    unsigned long long c;
+    if (n > 0 && term_store.checkpoint(n, c)) {
+        // Start from the stored F(c), L(c) and add the short remainder
+        term_store.load(c, f, l);
+        if (static_cast<unsigned long long>(n) == c) return;
+        BigInt fd, ld;
+        fibonacci_lucas_big(n - c, fd, ld);
+        fibonacci_lucas_add(f, l, fd, ld);
+        return;
+    }
+    
+    f = BigInt(0);
+    l = BigInt(2);
+    if (n <= 0) return;
+    
+    bool k_odd = false;
+    int top = 63 - __builtin_clzll(static_cast<unsigned long long>(n));
+    for (int bit = top; bit >= 0; bit--) {
+        // Double: k -> 2k
+        BigInt f2 = f * l;
+        BigInt l2 = l * l;
+        if (k_odd) l2 += BigInt(2);
+        else l2 -= BigInt(2);
+        f = f2;
+        l = l2;
+        k_odd = false;
         
-        switch(choice) {
-            case 1: {
-                cout << "\nLucas(" << n << ") = " << lucas_iterative(n) << endl;
-                pressEnterToContinue();
-                break;
+        // Step: 2k -> 2k + 1
+        if ((n >> bit) & 1) {
+            BigInt f1 = f + l;
+            BigInt l1 = f.mulSmall(5) + l;
+            f1 >>= 1;
+            l1 >>= 1;
+            f = f1;
+            l = l1;
+            k_odd = true;
+        }
+    }
+}
+
+// Addition formulas: (f, l) = (F(c), L(c)) becomes (F(c+d), L(c+d)) with
+//   F(c+d) = (F(c)L(d) + L(c)F(d)) / 2
+//   L(c+d) = (L(c)L(d) + 5F(c)F(d)) / 2
+// using three products (Karatsuba's trick on the cross terms), each of them
+// unbalanced when d is much smaller than c.
+void fibonacci_lucas_add(BigInt& f, BigInt& l, const BigInt& fd, const BigInt& ld) {
+    BigInt ff = f * fd, ll = l * ld;
+    BigInt sum_f = (f + l) * (fd + ld) - ff - ll;
+    BigInt sum_l = ll + ff.mulSmall(5);
+    sum_f >>= 1;
+    sum_l >>= 1;
+    f = sum_f;
+    l = sum_l;
+}
+
+// ========== TERM STORE ==========
+// File layout: header, the 128-bit tables as (low, high) word pairs, one
+// 64-bit Pisano period per modulus, the checkpoint directory, then the limbs
+// of every checkpoint. All sections are 8-byte aligned. Checkpoints exist
+// for c = k * 2^j with j in [min_level, max_level]; for n >= 2^min_level the
+// lookup picks j four bits below the top of n, so the remainder n - c is
+// under n / 8 and its terms cost a fraction of computing F(n) directly.
+
+void open_default_term_store() {
+    const char* path = getenv("DM_TERM_STORE");
+    string error;
+    if (!term_store.open(path ? path : TERM_STORE_DEFAULT_PATH, error) && (path || error.find("cannot open") != 0)) {
+        cerr << "Warning: term store not used: " << error << endl;
+    }
+}
+
+// True when count records of record_size bytes starting at offset lie
+// inside a file of file_size bytes; written so no product or sum can wrap
+// on the values of a crafted header.
+static bool store_section_fits(uint64_t offset, uint64_t count, uint64_t record_size, uint64_t file_size) {
+    return offset <= file_size && count <= (file_size - offset) / record_size;
+}
+
+bool TermStore::open(const string& path, string& error) {
+    close();
+#ifdef _WIN32
+    error = "cannot open " + path + " (memory mapping is not available on Windows)";
+    return false;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    off_t length = lseek(fd, 0, SEEK_END);
+    if (length < static_cast<off_t>(sizeof(TermStoreHeader))) {
+        ::close(fd);
+        error = path + " is too short";
+        return false;
+    }
+    void* mapped = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "cannot map " + path;
+        return false;
+    }
+    
+    const TermStoreHeader* h = static_cast<const TermStoreHeader*>(mapped);
+    uint64_t checkpoints = h->max_level >= h->min_level ? uint64_t(h->max_level - h->min_level + 1) * h->per_level : 0;
+    if (memcmp(h->magic, "DMTERMS", 8) != 0) error = path + " is not a term store";
+    else if (h->version != VERSION) error = path + " has version " + to_string(h->version) + ", expected " + to_string(VERSION);
+    else if (h->byte_order != 0x01020304) error = path + " was written with a different byte order";
+    else if (h->file_size != static_cast<uint64_t>(length) || h->max_level >= 62 ||
+             !store_section_fits(h->wide_offset, uint64_t(h->wide_fibonacci) + h->wide_lucas, 16, h->file_size) ||
+             !store_section_fits(h->pisano_offset, h->pisano_moduli, 8, h->file_size) ||
+             !store_section_fits(h->directory_offset, checkpoints, sizeof(StoreCheckpoint), h->file_size)) {
+        error = path + " is truncated or corrupt";
+    }
+    if (!error.empty()) {
+        munmap(mapped, length);
+        return false;
+    }
+    
+    const StoreCheckpoint* directory = reinterpret_cast<const StoreCheckpoint*>(static_cast<const char*>(mapped) + h->directory_offset);
+    for (uint64_t i = 0; i < checkpoints; i++) {
+        uint64_t limbs = uint64_t(directory[i].f_limbs) + directory[i].l_limbs;
+        if (!store_section_fits(directory[i].offset, limbs, 4, h->file_size)) {
+            munmap(mapped, length);
+            error = path + " is truncated or corrupt";
+            return false;
+        }
+    }
+    data = static_cast<const char*>(mapped);
+    size = length;
+    header = h;
+    return true;
+#endif
+}
+
+void TermStore::close() {
+#ifndef _WIN32
+    if (data) munmap(const_cast<char*>(data), size);
+#endif
+    data = 0;
+    size = 0;
+    header = 0;
+}
+
+bool TermStore::checkpoint(unsigned long long n, unsigned long long& c) const {
+    if (!header || n < (1ULL << header->min_level)) return false;
+    int top = 63 - __builtin_clzll(n);
+    uint32_t level = max<int>(header->min_level, top - 3);
+    if (level > header->max_level) {
+        // Past the last level only the largest checkpoints help
+        level = header->max_level;
+        if ((n >> level) > header->per_level) return false;
+    }
+    c = (n >> level) << level;
+    return true;
+}
+
+void TermStore::load(unsigned long long c, BigInt& f, BigInt& l) const {
+    int level = __builtin_ctzll(c);
+    if (static_cast<uint32_t>(level) > header->max_level) level = header->max_level;
+    unsigned long long k = c >> level;
+    while (k > header->per_level || static_cast<uint32_t>(level) < header->min_level) {
+        k <<= 1; // c = k * 2^level with the level lowered into range
+        level--;
+    }
+    const StoreCheckpoint* directory = reinterpret_cast<const StoreCheckpoint*>(data + header->directory_offset);
+    const StoreCheckpoint& entry = directory[(level - header->min_level) * header->per_level + (k - 1)];
+    const uint32_t* limbs = reinterpret_cast<const uint32_t*>(data + entry.offset);
+    f.limbs.assign(limbs, limbs + entry.f_limbs);
+    l.limbs.assign(limbs + entry.f_limbs, limbs + entry.f_limbs + entry.l_limbs);
+}
+
+bool TermStore::wide(long long n, bool lucas, unsigned __int128& value) const {
+    if (!header || n < 0 || n >= (lucas ? header->wide_lucas : header->wide_fibonacci)) return false;
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(data + header->wide_offset) + 2 * (lucas ? header->wide_fibonacci + n : n);
+    value = (static_cast<unsigned __int128>(words[1]) << 64) | words[0];
+    return true;
+}
+
+bool TermStore::pisano(uint64_t m, unsigned __int128& period) const {
+    if (!header || m >= header->pisano_moduli) return false;
+    uint64_t stored = reinterpret_cast<const uint64_t*>(data + header->pisano_offset)[m];
+    if (stored == 0) return false;
+    period = stored;
+    return true;
+}
+
+int runBuildStore(const char* path, unsigned long long max_n) {
+    // Build from scratch rather than from a store that may be replaced
+    term_store.close();
+    string error;
+    auto start = high_resolution_clock::now();
+    if (!build_term_store(path, max_n, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+    auto elapsed = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    
+    term_store.open(path, error);
+    const TermStoreHeader* h = term_store.info();
+    cerr << "Wrote " << path << ": checkpoints up to " << (unsigned long long)h->per_level << " * 2^" << h->max_level
+         << ", " << h->pisano_moduli << " Pisano periods, " << (h->file_size >> 10) << " KiB in "
+         << elapsed.count() << " ms" << endl;
+    return 0;
+}
+
+// Writes to path.tmp and renames, so processes still mapping the old file
+// keep a consistent view of it.
+bool build_term_store(const string& path, unsigned long long max_n, string& error) {
+    TermStoreHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "DMTERMS", 8);
+    h.version = TermStore::VERSION;
+    h.byte_order = 0x01020304;
+    h.min_level = STORE_MIN_LEVEL;
+    h.per_level = STORE_PER_LEVEL;
+    h.max_level = STORE_MIN_LEVEL;
+    while (h.max_level < 40 && (unsigned long long)STORE_PER_LEVEL << h.max_level < max_n) h.max_level++;
+    h.pisano_moduli = STORE_PISANO_MODULI;
+    
+    vector<uint64_t> wide;
+    for (int lucas = 0; lucas < 2; lucas++) {
+        unsigned __int128 value;
+        uint32_t count = 0;
+        while (fibonacci_lucas_wide(count, lucas, value)) {
+            wide.push_back(static_cast<uint64_t>(value));
+            wide.push_back(static_cast<uint64_t>(value >> 64));
+            count++;
+        }
+        (lucas ? h.wide_lucas : h.wide_fibonacci) = count;
+    }
+    
+    vector<uint64_t> periods(h.pisano_moduli, 0);
+    for (uint64_t m = 1; m < h.pisano_moduli; m++) periods[m] = static_cast<uint64_t>(pisano_period(m));
+    
+    uint32_t checkpoints = (h.max_level - h.min_level + 1) * h.per_level;
+    h.wide_offset = sizeof(h);
+    h.pisano_offset = h.wide_offset + 8 * wide.size();
+    h.directory_offset = h.pisano_offset + 8 * periods.size();
+    uint64_t offset = h.directory_offset + sizeof(StoreCheckpoint) * checkpoints;
+    
+    string temp = path + ".tmp";
+    ofstream out(temp.c_str(), ios::binary);
+    if (!out) {
+        error = "cannot create " + temp;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h)); // rewritten once file_size is known
+    out.write(reinterpret_cast<const char*>(wide.data()), 8 * wide.size());
+    out.write(reinterpret_cast<const char*>(periods.data()), 8 * periods.size());
+    out.write(string(sizeof(StoreCheckpoint) * checkpoints, '\0').data(), sizeof(StoreCheckpoint) * checkpoints);
+    
+    // Checkpoints of one level are k * 2^j; each is reached from the
+    // previous one by adding F(2^j), L(2^j)
+    vector<StoreCheckpoint> directory;
+    BigInt step_f, step_l;
+    for (uint32_t level = h.min_level; level <= h.max_level; level++) {
+        fibonacci_lucas_big(1LL << level, step_f, step_l);
+        BigInt f = step_f, l = step_l;
+        for (uint32_t k = 1; k <= h.per_level; k++) {
+            if (k > 1) fibonacci_lucas_add(f, l, step_f, step_l);
+            StoreCheckpoint entry = {offset, static_cast<uint32_t>(f.limbs.size()), static_cast<uint32_t>(l.limbs.size())};
+            directory.push_back(entry);
+            out.write(reinterpret_cast<const char*>(f.limbs.data()), 4 * f.limbs.size());
+            out.write(reinterpret_cast<const char*>(l.limbs.data()), 4 * l.limbs.size());
+            size_t written = 4 * (f.limbs.size() + l.limbs.size());
+            if (written % 8) out.write("\0\0\0\0", 4);
+            offset += (written + 7) / 8 * 8;
+        }
+    }
+    
+    h.file_size = offset;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.seekp(h.directory_offset);
+    out.write(reinterpret_cast<const char*>(directory.data()), sizeof(StoreCheckpoint) * directory.size());
+    out.close();
+    if (!out) {
+        error = "cannot write " + temp;
+        return false;
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        error = "cannot replace " + path;
+        return false;
+    }
+    return true;
+}
+
+// ========== SEQUENCE RANGES ==========
+bool SequenceRange::next(vector<BigInt>& terms) {
+    if (index > last) {
+        terms.clear();
+        return false;
+    }
+    if (!seeded) {
+        // F(m+1) = (F(m) + L(m)) / 2 and L(m+1) = (5F(m) + L(m)) / 2
+        BigInt f, l;
+        fibonacci_lucas_big(index, f, l);
+        following = (lucas ? f.mulSmall(5) : f) + l;
+        following >>= 1;
+        current = lucas ? l : f;
+        seeded = true;
+    }
+    
+    // Assigning into the caller's terms reuses their limb buffers
+    size_t count = static_cast<size_t>(min<long long>(chunk, last - index + 1));
+    terms.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        terms[i] = current;
+        current += following;
+        swap(current, following);
+    }
+    index += count;
+    return true;
+}
+
+// X(n) has about n / 4.78 digits, so a block holds roughly
+// SEQUENCE_BLOCK_BYTES of text at its far end
+size_t sequence_block_terms(long long last) {
+    size_t line = static_cast<size_t>(last / 4) + 16;
+    return max<size_t>(1, min(SEQUENCE_CHUNK_TERMS, SEQUENCE_BLOCK_BYTES / line));
+}
+
+// Writes "X(i) = value" for i = first..last in order. Blocks of indices are
+// claimed by worker threads, each seeding its own range with a fast-doubling
+// jump and formatting its block; the calling thread writes finished blocks
+// in order. A worker may run at most 2 * threads blocks ahead of the writer,
+// which bounds memory however long the range is.
+bool write_sequence_range(const SequenceSpec& spec, long long first, long long last, unsigned threads, FILE* out) {
+    threads = max(1u, threads);
+    long long block = static_cast<long long>(sequence_block_terms(last));
+    long long blocks = first > last ? 0 : (last - first) / block + 1;
+    long long window = 2 * threads;
+    vector<string> texts(window);
+    vector<char> finished(window, 0);
+    long long claimed = 0, written = 0;
+    mutex lock;
+    condition_variable changed;
+    
+    auto work = [&]() {
+        vector<BigInt> terms;
+        while (true) {
+            long long b;
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [&]() { return claimed >= blocks || claimed < written + window; });
+                if (claimed >= blocks) return;
+                b = claimed++;
             }
-            case 2: {
-                vector<long long> seq = lucas_sequence(n);
-                cout << "\nLucas sequence up to term " << n << ":" << endl;
-                cout << string(30, '-') << endl;
-                for (int i = 0; i <= n; i++) {
-                    cout << "L(" << i << ") = " << seq[i] << endl;
+            
+            string text;
+            char number[24];
+            long long i = first + b * block;
+            SequenceRange range = spec.range(i, min(last, i + block - 1));
+            while (range.next(terms)) {
+                for (size_t t = 0; t < terms.size(); t++, i++) {
+                    text += spec.symbol;
+                    text += '(';
+                    text.append(number, to_chars(number, number + sizeof(number), i).ptr);
+                    text += ") = ";
+                    limbs_append_decimal(terms[t].limbs, text);
+                    text += '\n';
                 }
-                pressEnterToContinue();
-                break;
             }
-            case 3: {
-                if (n > 40) {
-                    cout << "Warning: Recursive method will be slow for n > 40!" << endl;
-                    cout << "Continue anyway? (1=Yes, 0=No): ";
-                    int continue_choice;
-                    cin >> continue_choice;
-                    if (!continue_choice) break;
-                }
-                
-                cout << "\n" << string(40, '-') << endl;
-                cout << "COMPARISON OF METHODS" << endl;
-                cout << string(40, '-') << endl;
-                
-                // Iterative
-                cout << "Iterative method:" << endl;
-                cout << "Lucas(" << n << ") = " << lucas_iterative(n) << endl;
-                
-                // Recursive (only if n is small)
-                if (n <= 30) {
-                    cout << "\nRecursive method:" << endl;
-                    cout << "Lucas(" << n << ") = " << lucas_recursive(n) << endl;
-                } else {
-                    cout << "\nRecursive method: Skipped (too large for n > 30)" << endl;
-                }
-                
-                // Memoized
-                cout << "\nMemoized method:" << endl;
-                if (n >= 0) memo_vec[0] = 2;
-                if (n >= 1) memo_vec[1] = 1;
-                cout << "Lucas(" << n << ") = " << lucas_memoized(n, memo_vec) << endl;
-                
-                cout << string(40, '-') << endl;
-                pressEnterToContinue();
-                break;
+            {
+                lock_guard<mutex> guard(lock);
+                texts[b % window].swap(text);
+                finished[b % window] = 1;
             }
-            default:
-                cout << "Invalid choice!" << endl;
-                pressEnterToContinue();
+            changed.notify_all();
+        }
+    };
+    vector<thread> workers;
+    for (unsigned t = 0; t < min<long long>(threads, blocks); t++) workers.push_back(thread(work));
+    
+    bool ok = true;
+    string text;
+    while (written < blocks) {
+        {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&]() { return finished[written % window] != 0; });
+            text.swap(texts[written % window]);
+            finished[written % window] = 0;
+            written++;
+        }
+        changed.notify_all();
+        ok = fwrite(text.data(), 1, text.size(), out) == text.size() && ok;
+        text.clear();
+    }
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+    return fflush(out) == 0 && ok;
+}
+
+int runSequenceExport(const string& sequence, long long first, long long last, unsigned threads) {
+    if ((sequence != "F" && sequence != "L") || first < 0 || last < first) {
+        cerr << "Error: expected F or L and 0 <= first <= last" << endl;
+        return 1;
+    }
+    auto start = high_resolution_clock::now();
+    if (!write_sequence_range(sequence == "F" ? fibonacci_spec() : lucas_spec(), first, last, threads, stdout)) {
+        cerr << "Error: cannot write the sequence" << endl;
+        return 1;
+    }
+    auto elapsed = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    cerr << (last - first + 1) << " terms written in " << elapsed.count() << " ms ("
+         << max(1u, threads) << " thread(s))" << endl;
+    return 0;
+}
+
+// ========== SHARED MEMO ==========
+SharedMemo::SharedMemo(unsigned long long first, unsigned long long second, int last)
+    : last_index(last), filled(0), hit_count(0), miss_count(0) {
+    initial[0] = first;
+    initial[1] = second;
+    for (int i = 0; i < MAX_SEGMENTS; i++) segments[i].store(0, memory_order_relaxed);
+}
+
+SharedMemo::~SharedMemo() {
+    for (int i = 0; i < MAX_SEGMENTS; i++) delete[] segments[i].load(memory_order_relaxed);
+}
+
+// Index i lives in segment floor(log2(i + 1)) at offset i + 1 - 2^segment
+unsigned long long& SharedMemo::slot(size_t index) {
+    int segment = 63 - __builtin_clzll(index + 1);
+    unsigned long long* base = segments[segment].load(memory_order_relaxed);
+    if (!base) {
+        base = new unsigned long long[size_t(1) << segment];
+        segments[segment].store(base, memory_order_relaxed);
+    }
+    return base[index + 1 - (size_t(1) << segment)];
+}
+
+long long SharedMemo::get(int n) {
+    if (n < 0 || n > last_index) return -1;
+    size_t index = n;
+    
+    if (index < filled.load(memory_order_acquire)) {
+        hit_count.fetch_add(1, memory_order_relaxed);
+        return static_cast<long long>(slot(index));
+    }
+    
+    miss_count.fetch_add(1, memory_order_relaxed);
+    lock_guard<mutex> lock(grow_mutex);
+    size_t have = filled.load(memory_order_relaxed);
+    for (size_t i = have; i <= index; i++) {
+        slot(i) = i < 2 ? initial[i] : slot(i - 1) + slot(i - 2);
+    }
+    if (index >= have) filled.store(index + 1, memory_order_release);
+    return static_cast<long long>(slot(index));
+}
+
+// ========== WORK-STEALING POOL ==========
+// The pool this thread is a worker of and its index there. A worker of one
+// pool that uses another (a range worker multiplying on the NTT pool, a
+// nested parallel recursion) is an outside thread to the second one.
+struct PoolWorkerSlot {
+    const WorkStealingPool* pool;
+    unsigned index;
+};
+thread_local PoolWorkerSlot pool_worker = {0, 0};
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+    : stopping(false), queued(0), sleepers(0), steal_count(0) {
+    threads = max(1u, threads);
+    for (unsigned i = 0; i < threads; i++) workers.push_back(unique_ptr<Worker>(new Worker()));
+    for (unsigned i = 1; i < threads; i++) {
+        this->threads.push_back(thread(&WorkStealingPool::worker_loop, this, i));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> guard(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+}
+
+// Threads outside the pool, the creating thread among them, share deque 0
+unsigned WorkStealingPool::self_index() const {
+    return pool_worker.pool == this ? pool_worker.index : 0;
+}
+
+void WorkStealingPool::spawn(TaskGroup& group, function<void()> task) {
+    group.pending.fetch_add(1, memory_order_relaxed);
+    unsigned self = self_index();
+    {
+        lock_guard<mutex> guard(workers[self]->lock);
+        Task entry = {task, &group};
+        workers[self]->tasks.push_back(entry);
+    }
+    queued.fetch_add(1, memory_order_release);
+    if (sleepers.load(memory_order_acquire) > 0) {
+        lock_guard<mutex> guard(sleep_mutex);
+        wake.notify_one();
+    }
+}
+
+// Helps with queued work until every task of the group has finished
+void WorkStealingPool::wait(TaskGroup& group) {
+    unsigned self = self_index();
+    while (group.pending.load(memory_order_acquire) > 0) {
+        if (!run_one(self)) this_thread::yield();
+    }
+}
+
+// Runs the newest task of this worker, else the oldest task of the first
+// victim (scanning from self + 1) that has one.
+bool WorkStealingPool::run_one(unsigned self) {
+    Task task;
+    bool found = false;
+    unsigned count = size();
+    for (unsigned i = 0; i < count && !found; i++) {
+        Worker& victim = *workers[(self + i) % count];
+        lock_guard<mutex> guard(victim.lock);
+        if (victim.tasks.empty()) continue;
+        if (i == 0) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+        } else {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            steal_count.fetch_add(1, memory_order_relaxed);
+        }
+        found = true;
+    }
+    if (!found) return false;
+    
+    queued.fetch_sub(1, memory_order_relaxed);
+    task.run();
+    task.group->pending.fetch_sub(1, memory_order_release);
+    return true;
+}
+
+void WorkStealingPool::worker_loop(unsigned self) {
+    PoolWorkerSlot slot = {this, self};
+    pool_worker = slot;
+    while (!stopping.load(memory_order_acquire)) {
+        if (run_one(self)) continue;
+        unique_lock<mutex> guard(sleep_mutex);
+        sleepers++;
+        wake.wait_for(guard, milliseconds(1), [this]() {
+            return stopping.load(memory_order_acquire) || queued.load(memory_order_acquire) > 0;
+        });
+        sleepers--;
+    }
+}
+
+// Sequential cutoff for the parallel recursions, overridable with DM_CUTOFF
+int parallel_cutoff() {
+    const char* value = getenv("DM_CUTOFF");
+    int cutoff = value ? atoi(value) : DEFAULT_PARALLEL_CUTOFF;
+    return cutoff > 1 ? cutoff : DEFAULT_PARALLEL_CUTOFF;
+}
+
+// 1, 2, 4, ... up to the hardware thread count (which is always included)
+vector<unsigned> scaling_thread_counts() {
+    unsigned hardware = max(1u, thread::hardware_concurrency());
+    vector<unsigned> counts;
+    for (unsigned t = 1; t < hardware; t *= 2) counts.push_back(t);
+    counts.push_back(hardware);
+    return counts;
+}
+
+void printParallelScaling(const SequenceSpec& spec, int n) {
+    int cutoff = parallel_cutoff();
+    string label = spec.name + "(" + to_string(n) + ")";
+    cout << "\nParallel recursive method (work stealing, cutoff " << cutoff << "):" << endl;
+    
+    auto start = high_resolution_clock::now();
+    long long expected = spec.recursive(n);
+    double sequential = duration<double, milli>(high_resolution_clock::now() - start).count();
+    
+    cout << setw(8) << "Threads" << setw(14) << "Time (ms)" << setw(10) << "Speedup" << setw(10) << "Steals" << endl;
+    cout << setw(8) << "seq" << setw(14) << fixed << setprecision(2) << sequential << setw(10) << 1.0 << setw(10) << "-" << endl;
+    vector<unsigned> counts = scaling_thread_counts();
+    long long result = expected;
+    for (size_t i = 0; i < counts.size(); i++) {
+        WorkStealingPool pool(counts[i]);
+        start = high_resolution_clock::now();
+        result = spec.parallel_recursive(n, pool, cutoff);
+        double elapsed = duration<double, milli>(high_resolution_clock::now() - start).count();
+        cout << setw(8) << counts[i] << setw(14) << elapsed << setw(10) << sequential / max(elapsed, 1e-6)
+             << setw(10) << pool.steals() << endl;
+    }
+    cout << defaultfloat;
+    cout << label << " = " << result << (result == expected ? "" : " (MISMATCH!)") << endl;
+}
+
+// ========== TIERED TERM DISPATCH ==========
+// Answers from the compile-time table while the term fits in 64 bits, then
+// tries 128-bit fast doubling with every operation overflow-checked, and only
+// falls back to big integers once that overflows.
+TermValue dispatch_term(long long n, bool lucas) {
+    TermValue value;
+    value.small = 0;
+    value.wide = 0;
+    
+    const unsigned long long* table = lucas ? LUCAS_TABLE.data() : FIBONACCI_TABLE.data();
+    long long table_size = lucas ? LUCAS_TABLE.size() : FIBONACCI_TABLE.size();
+    if (n < table_size) {
+        value.tier = TermValue::TABLE_64;
+        value.small = table[n];
+        return value;
+    }
+    
+    // A loaded store holds every term that fits in 128 bits
+    bool fits = term_store.isOpen() ? term_store.wide(n, lucas, value.wide) : fibonacci_lucas_wide(n, lucas, value.wide);
+    if (fits) {
+        value.tier = TermValue::WIDE_128;
+        return value;
+    }
+    
+    value.tier = TermValue::BIG;
+    value.big = lucas ? lucas_big(n) : fibonacci_big(n);
+    return value;
+}
+
+// Fast doubling in unsigned 128-bit arithmetic. Each of F and L carries its
+// own overflow flag, since near the top of the range one can overflow while
+// the other still fits. The step uses
+//   F(m+1) = F(m) + (L(m) - F(m)) / 2,  L(m+1) = 2F(m) + F(m+1)
+// which never exceed the final values. Returns false on overflow.
+bool fibonacci_lucas_wide(long long n, bool want_lucas, unsigned __int128& result) {
+    unsigned __int128 f = 0, l = 2;
+    bool f_ok = true, l_ok = true;
+    bool k_odd = false;
+    
+    int top = n > 0 ? 63 - __builtin_clzll(static_cast<unsigned long long>(n)) : -1;
+    for (int bit = top; bit >= 0; bit--) {
+        unsigned __int128 f2 = 0, l2 = 0;
+        bool f2_ok = f_ok && l_ok && !__builtin_mul_overflow(f, l, &f2);
+        bool l2_ok = l_ok && !__builtin_mul_overflow(l, l, &l2);
+        if (l2_ok) {
+            if (k_odd) l2_ok = !__builtin_add_overflow(l2, 2, &l2);
+            else l2 -= 2;
+        }
+        f = f2;
+        l = l2;
+        f_ok = f2_ok;
+        l_ok = l2_ok;
+        k_odd = false;
+        
+        if ((n >> bit) & 1) {
+            if (!f_ok || !l_ok) return false;
+            unsigned __int128 f1 = f + (l - f) / 2, l1;
+            bool l1_ok = !__builtin_add_overflow(2 * f, f1, &l1) && f <= (~static_cast<unsigned __int128>(0)) / 2;
+            f = f1;
+            l = l1;
+            l_ok = l1_ok;
+            k_odd = true;
+        }
+    }
+    
+    if (want_lucas ? !l_ok : !f_ok) return false;
+    result = want_lucas ? l : f;
+    return true;
+}
+
+string TermValue::toString() const {
+    switch (tier) {
+        case TABLE_64: return to_string(small);
+        case WIDE_128: return u128_to_string(wide);
+        default: return big.toString();
+    }
+}
+
+const char* TermValue::tierName() const {
+    switch (tier) {
+        case TABLE_64: return "64-bit (compile-time table)";
+        case WIDE_128: return "128-bit (checked fast doubling)";
+        default: return "big integer";
+    }
+}
+
+// Prints small values in full. Huge values are summarised (digit count,
+// leading and trailing digits); save_big_term writes every digit.
+void printBigTerm(const string& label, const BigInt& value, bool negative) {
+    if (value.bitLength() <= BIG_DISPLAY_LIMIT_BITS) {
+        cout << label << " = " << (negative ? "-" : "") << value.toString() << endl;
+        return;
+    }
+    
+    size_t size = value.limbs.size();
+    double top = value.limbs[size - 1] * 4294967296.0 + value.limbs[size - 2];
+    double log10_value = log10(top) + 32.0 * (size - 2) * log10(2.0);
+    long long digits = static_cast<long long>(floor(log10_value)) + 1;
+    double fraction = log10_value - floor(log10_value);
+    long long leading = static_cast<long long>(pow(10.0, fraction + 9));
+    
+    ostringstream trailing;
+    trailing << setw(18) << setfill('0') << value.mod(1000000000000000000ULL);
+    
+    cout << label << " has " << digits << " digits (" << value.bitLength() << " bits)"
+         << (negative ? ", negative" : "") << endl;
+    cout << "Leading digits:  " << leading << "..." << endl;
+    cout << "Trailing digits: ..." << trailing.str() << endl;
+}
+
+// Streams the digits through an OutputBuffer. Hexadecimal is read straight
+// off the limbs; decimal goes through the divide-and-conquer converter.
+bool save_big_term(const string& path, const BigInt& value, bool hex, string& error) {
+    FILE* out = path == "-" ? stdout : fopen(path.c_str(), "wb");
+    if (!out) {
+        error = "cannot open " + path;
+        return false;
+    }
+    bool ok;
+    {
+        OutputBuffer writer(out);
+        if (!hex) {
+            writer << value;
+        } else if (value.isZero()) {
+            writer << '0';
+        } else {
+            const char* HEX = "0123456789abcdef";
+            size_t top = value.limbs.size() - 1;
+            int shift = 28;
+            while ((value.limbs[top] >> shift) == 0) shift -= 4;
+            for (size_t i = top + 1; i-- > 0;) {
+                for (; shift >= 0; shift -= 4) writer << HEX[(value.limbs[i] >> shift) & 15];
+                shift = 28;
+            }
+        }
+        writer << '\n';
+        ok = writer.flush();
+    }
+    if (out != stdout) ok = fclose(out) == 0 && ok;
+    if (!ok) error = "cannot write " + path;
+    return ok;
+}
+
+int runTermToFile(const string& sequence, long long n, const string& path, bool hex) {
+    if ((sequence != "F" && sequence != "L") || n < 0) {
+        cerr << "Error: expected F or L and a non-negative n" << endl;
+        return 1;
+    }
+    auto start = high_resolution_clock::now();
+    BigInt f, l;
+    fibonacci_lucas_big(n, f, l);
+    const BigInt& value = sequence == "F" ? f : l;
+    auto computed = high_resolution_clock::now();
+    string error;
+    if (!save_big_term(path, value, hex, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+    auto written = high_resolution_clock::now();
+    cerr << sequence << "(" << n << "): " << value.bitLength() << " bits, computed in "
+         << duration_cast<milliseconds>(computed - start).count() << " ms, written in "
+         << duration_cast<milliseconds>(written - computed).count() << " ms" << endl;
+    return 0;
+}
+
+// ========== MODULAR QUERIES ==========
+void modularTermQuery(const SequenceSpec& spec) {
+    unsigned long long n, m;
+    cout << "Enter term position (0 to 10^18): ";
+    cin >> n;
+    cout << "Enter modulus m (1 to 2^63 - 1): ";
+    cin >> m;
+    
+    if (!cin || m == 0 || m > MAX_MODULUS) {
+        cout << "Error: Modulus must be between 1 and 2^63 - 1!" << endl;
+        cin.clear();
+        pressEnterToContinue();
+        return;
+    }
+    
+    // Fibonacci and Lucas reduce n by the cached Pisano period; other
+    // recurrences run the generic engine directly modulo m
+    ModularContext context;
+    bool cached = find_modular_context(m, context);
+    auto start = high_resolution_clock::now();
+    uint64_t value = spec.modular ? spec.modular(n, m) : recurrence_term(spec.recurrence, n, ModRing(m));
+    auto elapsed = duration_cast<microseconds>(high_resolution_clock::now() - start);
+    
+    cout << "\n" << spec.name << "(" << n << ") mod " << m << " = " << value << endl;
+    if (spec.modular) {
+        cout << "Pisano period of " << m << ": " << u128_to_string(modular_context(m).period)
+             << (cached ? " (cached)" : " (computed)") << endl;
+    }
+    cout << "Computed in " << elapsed.count() << " us" << endl;
+    pressEnterToContinue();
+}
+
+// Looks up (or builds and caches) the context for modulus m. Contexts are
+// returned by copy, since another thread may evict the cached one.
+ModularContext modular_context(uint64_t m) {
+    ModularContext context;
+    if (find_modular_context(m, context)) return context;
+    context = ModularContext(m);
+    store_modular_context(context);
+    return context;
+}
+
+bool find_modular_context(uint64_t m, ModularContext& context) {
+    lock_guard<mutex> guard(modular_cache_mutex);
+    map<uint64_t, ModularContext>::iterator it = modular_cache.find(m);
+    if (it == modular_cache.end()) return false;
+    context = it->second;
+    return true;
+}
+
+void store_modular_context(const ModularContext& context) {
+    lock_guard<mutex> guard(modular_cache_mutex);
+    if (!modular_cache.insert(make_pair(context.modulus, context)).second) return;
+    modular_cache_order.push_back(context.modulus);
+    if (modular_cache_order.size() > MODULAR_CACHE_ENTRIES) {
+        modular_cache.erase(modular_cache_order.front());
+        modular_cache_order.pop_front();
+    }
+}
+
+uint64_t fibonacci_mod(unsigned long long n, uint64_t m) {
+    return modular_context(m).fibonacciPair(n).first;
+}
+
+// L(n) = 2F(n+1) - F(n)
+uint64_t lucas_mod(unsigned long long n, uint64_t m) {
+    pair<uint64_t, uint64_t> f = modular_context(m).fibonacciPair(n);
+    unsigned __int128 value = 2 * static_cast<unsigned __int128>(f.second) + m - f.first;
+    return static_cast<uint64_t>(value % m);
+}
+
+ModularContext::ModularContext(uint64_t m, bool with_period) : modulus(m), period(with_period ? pisano_period(m) : 0) {
+    if (m % 2 == 1) montgomery = Montgomery64(m);
+    else barrett = Barrett64(m);
+}
+
+pair<uint64_t, uint64_t> ModularContext::fibonacciPair(unsigned __int128 n) const {
+    if (modulus == 1) return make_pair(0, 0);
+    if (period != 0) n %= period;
+    if (modulus % 2 == 1) return fibonacci_pair_mod(n, montgomery);
+    return fibonacci_pair_mod(n, barrett);
+}
+
+// Fast doubling on F alone, which needs no division and so works for every
+// modulus:
+//   F(2k)   = F(k) * (2F(k+1) - F(k))
+//   F(2k+1) = F(k)^2 + F(k+1)^2
+template <class Arith>
+pair<uint64_t, uint64_t> fibonacci_pair_mod(unsigned __int128 n, const Arith& arith) {
+    uint64_t a = arith.toForm(0), b = arith.toForm(1);
+    
+    int top = 127;
+    while (top >= 0 && !((n >> top) & 1)) top--;
+    
+    for (int bit = top; bit >= 0; bit--) {
+        uint64_t c = arith.mul(a, arith.sub(arith.add(b, b), a));
+        uint64_t d = arith.add(arith.mul(a, a), arith.mul(b, b));
+        if ((n >> bit) & 1) {
+            a = d;
+            b = arith.add(c, d);
+        } else {
+            a = c;
+            b = d;
+        }
+    }
+    return make_pair(arith.fromForm(a), arith.fromForm(b));
+}
+
+// pi(m) is the lcm of pi(p^k) over the prime powers of m, and
+// pi(p^k) = p^(k-1) * pi(p).
+unsigned __int128 pisano_period(uint64_t m) {
+    if (m == 1) return 1;
+    unsigned __int128 stored;
+    if (term_store.pisano(m, stored)) return stored;
+    
+    unsigned __int128 period = 1;
+    vector<pair<uint64_t, int>> factors = factorize(m);
+    for (size_t i = 0; i < factors.size(); i++) {
+        unsigned __int128 prime_power_period = pisano_period_prime(factors[i].first);
+        for (int e = 1; e < factors[i].second; e++) prime_power_period *= factors[i].first;
+        period = period / gcd_u128(period, prime_power_period) * prime_power_period;
+    }
+    return period;
+}
+
+// For p = +-1 mod 5 the period divides p - 1, otherwise it divides 2(p + 1).
+// Start from that bound and strip prime factors while F(d) = 0, F(d+1) = 1.
+unsigned __int128 pisano_period_prime(uint64_t p) {
+    if (p == 2) return 3;
+    if (p == 5) return 20;
+    
+    unsigned __int128 period;
+    vector<pair<uint64_t, int>> factors;
+    if (p % 5 == 1 || p % 5 == 4) {
+        period = p - 1;
+        factors = factorize(p - 1);
+    } else {
+        // 2(p + 1) = 4 * ((p + 1) / 2)
+        period = 2 * static_cast<unsigned __int128>(p + 1);
+        factors = factorize((p + 1) / 2);
+        bool has_two = false;
+        for (size_t i = 0; i < factors.size(); i++) {
+            if (factors[i].first == 2) {
+                factors[i].second += 2;
+                has_two = true;
+            }
+        }
+        if (!has_two) factors.push_back(make_pair(2, 2));
+    }
+    
+    Montgomery64 arith(p);
+    for (size_t i = 0; i < factors.size(); i++) {
+        uint64_t q = factors[i].first;
+        for (int e = 0; e < factors[i].second; e++) {
+            pair<uint64_t, uint64_t> f = fibonacci_pair_mod(period / q, arith);
+            if (f.first != 0 || f.second != 1) break;
+            period /= q;
+        }
+    }
+    return period;
+}
+
+Montgomery64::Montgomery64(uint64_t modulus) : m(modulus) {
+    // Newton iteration doubles the number of correct low bits each round
+    uint64_t inv = m;
+    for (int i = 0; i < 5; i++) inv *= 2 - m * inv;
+    m_inv = inv;
+    uint64_t r1 = (0 - m) % m; // 2^64 mod m
+    r2 = static_cast<uint64_t>(static_cast<unsigned __int128>(r1) * r1 % m);
+}
+
+// t - q*m is a multiple of 2^64 (the low words cancel), so only the high
+// words are subtracted; this never overflows even for m close to 2^64.
+uint64_t Montgomery64::reduce(unsigned __int128 t) const {
+    uint64_t q = static_cast<uint64_t>(t) * m_inv;
+    uint64_t qm_high = static_cast<uint64_t>((static_cast<unsigned __int128>(q) * m) >> 64);
+    uint64_t t_high = static_cast<uint64_t>(t >> 64);
+    return t_high >= qm_high ? t_high - qm_high : t_high - qm_high + m;
+}
+
+Barrett64::Barrett64(uint64_t modulus) : m(modulus), mu(~static_cast<unsigned __int128>(0) / modulus) {}
+
+// q approximates floor(x * mu / 2^128) from below (the low*low partial
+// product is dropped), so a couple of correction steps may follow.
+uint64_t Barrett64::reduce(unsigned __int128 x) const {
+    uint64_t x0 = static_cast<uint64_t>(x), x1 = static_cast<uint64_t>(x >> 64);
+    uint64_t u0 = static_cast<uint64_t>(mu), u1 = static_cast<uint64_t>(mu >> 64);
+    
+    unsigned __int128 middle = (static_cast<unsigned __int128>(x0) * u0 >> 64)
+                             + static_cast<unsigned __int128>(x1) * u0;
+    middle = (middle >> 64) + ((static_cast<unsigned __int128>(x0) * u1 + static_cast<uint64_t>(middle)) >> 64);
+    unsigned __int128 q = middle + static_cast<unsigned __int128>(x1) * u1;
+    
+    unsigned __int128 r = x - q * m;
+    while (r >= m) r -= m;
+    return static_cast<uint64_t>(r);
+}
+
+// ========== BATCH MODE ==========
+// Gaps between neighbouring sorted indices up to this size are walked with
+// F(k+1) = F(k) + F(k-1); larger gaps restart the doubling chain.
+const uint64_t BATCH_STEP_LIMIT = 64;
+// Largest n answered exactly (without a modulus) in batch mode
+const uint64_t BATCH_MAX_EXACT_N = 10000000;
+
+int runCommandLine(int argc, char* argv[]) {
+    string option = argv[1];
+    if (option == "--batch") {
+        return runBatch(argc > 2 ? argv[2] : "-");
+    }
+    if (option == "--export-hanoi" && argc >= 4) {
+        int disks = atoi(argv[2]);
+        bool binary = argc > 4 && string(argv[4]) == "binary";
+        unsigned threads = argc > 5 ? static_cast<unsigned>(atoi(argv[5])) : thread::hardware_concurrency();
+        if (disks < 1 || disks > HanoiMoves::MAX_DISKS) {
+            cerr << "Error: disks must be between 1 and " << HanoiMoves::MAX_DISKS << endl;
+            return 1;
+        }
+        string error;
+        auto start = high_resolution_clock::now();
+        if (!export_hanoi_moves(disks, argv[3], binary, threads, error)) {
+            cerr << "Error: " << error << endl;
+            return 1;
+        }
+        auto elapsed = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+        cerr << hanoi_move_count_string(disks) << " moves written in " << elapsed.count() << " ms" << endl;
+        return 0;
+    }
+    if (option == "--validate-hanoi" && argc >= 3) {
+        return runValidation(argv[2], argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? atoi(argv[4]) : 3);
+    }
+    if (option == "--build-store") {
+        return runBuildStore(argc > 2 ? argv[2] : TERM_STORE_DEFAULT_PATH, argc > 3 ? strtoull(argv[3], 0, 10) : 1ULL << 22);
+    }
+    if (option == "--term" && argc >= 5) {
+        return runTermToFile(argv[2], atoll(argv[3]), argv[4], argc > 5 && string(argv[5]) == "hex");
+    }
+    if (option == "--sequence" && argc >= 5) {
+        unsigned threads = argc > 5 ? static_cast<unsigned>(atoi(argv[5])) : thread::hardware_concurrency();
+        return runSequenceExport(argv[2], atoll(argv[3]), atoll(argv[4]), max(1u, threads));
+    }
+    if (option == "--primes") {
+        unsigned threads = argc > 3 ? static_cast<unsigned>(atoi(argv[3])) : thread::hardware_concurrency();
+        return runPrimeBatch(argc > 2 ? argv[2] : "-", max(1u, threads));
+    }
+    if (option == "--serve" && argc >= 3) {
+        return runServer(argv[2]);
+    }
+    if (option == "--codec-bench") {
+        long long count = argc > 2 ? atoll(argv[2]) : static_cast<long long>(CODEC_BENCH_VALUES);
+        return runCodecBenchmark(static_cast<size_t>(max(1LL, count)));
+    }
+    if (option == "--bench") {
+        return runBenchmarks(argc > 2 ? argv[2] : "all", argc > 3 ? argv[3] : "json", argc > 4 ? argv[4] : "-");
+    }
+    printUsage(argv[0]);
+    return option == "--help" ? 0 : 1;
+}
+
+void printUsage(const char* program) {
+    cout << "Usage: " << program << "                 interactive menu" << endl;
+    cout << "       " << program << " --batch [file]  answer queries from file (default: stdin)" << endl;
+    cout << "       " << program << " --export-hanoi n file [text|binary] [threads]" << endl;
+    cout << "                                 write every move of the n-disk solution" << endl;
+    cout << "       " << program << " --term F|L n file [dec|hex]" << endl;
+    cout << "                                 write every digit of one huge term to file" << endl;
+    cout << "       " << program << " --sequence F|L first last [threads]" << endl;
+    cout << "                                 print terms first..last, generated in parallel blocks" << endl;
+    cout << "       " << program << " --primes [file] [threads]" << endl;
+    cout << "                                 BPSW-test one integer per line (any size)" << endl;
+    cout << "       " << program << " --serve socket-path|tcp:port" << endl;
+    cout << "                                 answer F/L/H query lines from many clients" << endl;
+    cout << "       " << program << " --validate-hanoi file [disks] [pegs]" << endl;
+    cout << "                                 check an exported move file (disks needed for text files)" << endl;
+    cout << "       " << program << " --build-store [file] [max-n]" << endl;
+    cout << "                                 precompute checkpoints up to max-n (default: "
+         << TERM_STORE_DEFAULT_PATH << ", 4194304)" << endl;
+    cout << "       " << program << " --bench [fibonacci|lucas|hanoi|all] [json|csv] [file]" << endl;
+    cout << "                                 run the benchmark suite (default: all, json, stdout)" << endl;
+    cout << "       " << program << " --codec-bench [count]" << endl;
+    cout << "                                 compare Fibonacci coding with varint on random arrays" << endl;
+    cout << "\nEach query line is \"F n [m]\" or \"L n [m]\": the nth Fibonacci or Lucas" << endl;
+    cout << "term, reduced modulo m when m is given. Results are written one per line" << endl;
+    cout << "in input order. Blank lines and lines starting with '#' are skipped." << endl;
+}
+
+int runBatch(const char* path) {
+    string input;
+    if (!readAllInput(path, input)) {
+        cerr << "Error: cannot read " << path << endl;
+        return 1;
+    }
+    
+    auto start = high_resolution_clock::now();
+    vector<BatchQuery> queries = parseBatchQueries(input);
+    vector<string> texts;
+    vector<BatchResult> results = evaluateBatch(queries, texts);
+    
+    // Results are formatted into one buffer and written with a single call
+    string output;
+    output.reserve(results.size() * 12);
+    char buffer[32];
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].text >= 0) {
+            output += texts[results[i].text];
+        } else {
+            to_chars_result written = to_chars(buffer, buffer + sizeof(buffer), results[i].value);
+            output.append(buffer, written.ptr);
+        }
+        output += '\n';
+    }
+    fwrite(output.data(), 1, output.size(), stdout);
+    fflush(stdout);
+    
+    auto elapsed = duration_cast<milliseconds>(high_resolution_clock::now() - start);
+    cerr << queries.size() << " queries answered in " << elapsed.count() << " ms"
+         << " (lane kernel: " << lane_kernel_name() << ")" << endl;
+    return 0;
+}
+
+bool readAllInput(const char* path, string& input) {
+    FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!file) return false;
+    
+    char buffer[1 << 16];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        input.append(buffer, count);
+    }
+    if (file != stdin) fclose(file);
+    return true;
+}
+
+vector<BatchQuery> parseBatchQueries(const string& input) {
+    vector<BatchQuery> queries;
+    const char* pos = input.data();
+    const char* end = pos + input.size();
+    
+    while (pos < end) {
+        const char* line_end = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        if (!line_end) line_end = end;
+        
+        const char* p = pos;
+        while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p < line_end && *p != '#') {
+            BatchQuery query = {0, 0, false, false};
+            char kind = static_cast<char>(toupper(*p));
+            while (p < line_end && isalpha(static_cast<unsigned char>(*p))) p++;
+            while (p < line_end && (*p == ' ' || *p == '\t')) p++;
+            
+            from_chars_result parsed = from_chars(p, line_end, query.n);
+            if ((kind == 'F' || kind == 'L') && parsed.ec == errc()) {
+                query.lucas = (kind == 'L');
+                query.valid = true;
+                p = parsed.ptr;
+                while (p < line_end && (*p == ' ' || *p == '\t')) p++;
+                if (p < line_end && *p != '\r') {
+                    parsed = from_chars(p, line_end, query.modulus);
+                    if (parsed.ec != errc() || query.modulus == 0 || query.modulus > MAX_MODULUS) {
+                        query.valid = false;
+                    }
+                }
+            }
+            queries.push_back(query);
+        }
+        pos = line_end + 1;
+    }
+    return queries;
+}
+
+// Queries are sorted by (modulus, index reduced by the Pisano period, kind) so
+// that duplicates are answered once and neighbouring indices are reached by a
+// few additions from the previous result instead of a fresh doubling chain.
+// Exact big terms likewise carry the pair F(n), L(n) forward and add the gap
+// to it with fast doubling. When unknown_moduli is given, moduli without a
+// cached context are not factorised here: their indices are used unreduced
+// and the moduli are listed for the caller to build later.
+vector<BatchResult> evaluateBatch(const vector<BatchQuery>& queries, vector<string>& texts,
+                                  vector<uint64_t>* unknown_moduli) {
+    BatchResult unset = {0, -1};
+    vector<BatchResult> results(queries.size(), unset);
+    
+    ModularContext context; // of the modulus seen last
+    bool have_context = false;
+    auto context_for = [&](uint64_t m) -> const ModularContext& {
+        if (have_context && context.modulus == m) return context;
+        if (!find_modular_context(m, context)) {
+            if (unknown_moduli) {
+                context = ModularContext(m, false);
+                unknown_moduli->push_back(m);
+            } else {
+                context = modular_context(m);
+            }
+        }
+        have_context = true;
+        return context;
+    };
+    
+    struct SortKey {
+        uint64_t modulus;
+        uint64_t n;
+        bool lucas;
+        uint32_t index;
+        bool operator<(const SortKey& other) const {
+            if (modulus != other.modulus) return modulus < other.modulus;
+            if (n != other.n) return n < other.n;
+            return lucas < other.lucas;
+        }
+    };
+    
+    vector<SortKey> keys;
+    keys.reserve(queries.size());
+    for (size_t i = 0; i < queries.size(); i++) {
+        const BatchQuery& q = queries[i];
+        if (!q.valid) {
+            results[i].text = static_cast<int>(texts.size());
+            texts.push_back("error: expected \"F n [m]\" or \"L n [m]\"");
+            continue;
+        }
+        uint64_t n = q.n;
+        if (q.modulus != 0) {
+            const ModularContext& modular = context_for(q.modulus);
+            if (modular.period != 0) n = static_cast<uint64_t>(n % modular.period);
+        } else if (n > BATCH_MAX_EXACT_N) {
+            results[i].text = static_cast<int>(texts.size());
+            texts.push_back("error: n too large for an exact result, give a modulus");
+            continue;
+        }
+        SortKey key = {q.modulus, n, q.lucas, static_cast<uint32_t>(i)};
+        keys.push_back(key);
+    }
+    sort(keys.begin(), keys.end());
+    
+    // Every restart of the walk is an independent doubling chain. Collect the
+    // ones the lane kernels can take and evaluate them all up front.
+    vector<LaneJob> lane_jobs;
+    for (size_t k = 0; k < keys.size(); k++) {
+        uint64_t m = keys[k].modulus;
+        bool restart = k == 0 || keys[k - 1].modulus != m || keys[k].n - keys[k - 1].n > BATCH_STEP_LIMIT;
+        if (restart && m > 1 && m <= LANE_MAX_MODULUS && m % 2 == 1) {
+            LaneJob job = {keys[k].n, static_cast<uint32_t>(m), 0, 0};
+            lane_jobs.push_back(job);
+        }
+    }
+    fibonacci_pairs_mod_lanes(lane_jobs);
+    size_t next_lane_job = 0;
+    
+    uint64_t current_modulus = 0, current_n = 0;
+    uint64_t f = 0, f1 = 1; // F(current_n), F(current_n + 1)
+    bool have_state = false;
+    BigInt big_f, big_l; // F(big_n), L(big_n) for the exact walk
+    long long big_n = -1;
+    
+    for (size_t k = 0; k < keys.size(); k++) {
+        const SortKey& key = keys[k];
+        const BatchQuery& q = queries[key.index];
+        uint64_t m = key.modulus;
+        
+        // Exact answers come from the tiered dispatcher while they fit in 128
+        // bits: a table lookup for 64-bit terms, text for the wider tier
+        if (m == 0) {
+            if (k > 0 && keys[k - 1].modulus == 0 && keys[k - 1].n == key.n && keys[k - 1].lucas == key.lucas) {
+                results[key.index] = results[keys[k - 1].index];
+                continue;
+            }
+            long long n = static_cast<long long>(key.n);
+            unsigned __int128 wide;
+            if (key.n < FIBONACCI_TABLE.size() || fibonacci_lucas_wide(n, q.lucas, wide)) {
+                TermValue term = dispatch_term(n, q.lucas);
+                if (term.tier == TermValue::TABLE_64) {
+                    results[key.index].value = term.small;
+                } else {
+                    results[key.index].text = static_cast<int>(texts.size());
+                    texts.push_back(term.toString());
+                }
+                continue;
+            }
+            
+            // Big terms: F(n), L(n) = F(big_n + d), L(big_n + d), where the
+            // gap d costs one short doubling chain and three products
+            if (big_n < 0) {
+                fibonacci_lucas_big(n, big_f, big_l);
+            } else if (n > big_n) {
+                BigInt fd, ld;
+                fibonacci_lucas_big(n - big_n, fd, ld);
+                fibonacci_lucas_add(big_f, big_l, fd, ld);
+            }
+            big_n = n;
+            results[key.index].text = static_cast<int>(texts.size());
+            texts.push_back((q.lucas ? big_l : big_f).toString());
+            continue;
+        }
+        
+        if (!have_state || m != current_modulus || key.n - current_n > BATCH_STEP_LIMIT) {
+            if (next_lane_job < lane_jobs.size() && lane_jobs[next_lane_job].n == key.n
+                       && lane_jobs[next_lane_job].modulus == m) {
+                f = lane_jobs[next_lane_job].f;
+                f1 = lane_jobs[next_lane_job].f1;
+                next_lane_job++;
+            } else {
+                pair<uint64_t, uint64_t> fp = context_for(m).fibonacciPair(key.n);
+                f = fp.first;
+                f1 = fp.second;
+            }
+            current_modulus = m;
+            current_n = key.n;
+            have_state = true;
+        }
+        
+        while (current_n < key.n) {
+            uint64_t next = f + f1;
+            if (next >= m) next -= m;
+            f = f1;
+            f1 = next;
+            current_n++;
+        }
+        
+        // L(n) = 2F(n+1) - F(n)
+        uint64_t value = f;
+        if (q.lucas) {
+            uint64_t twice = f1 + f1;
+            if (twice >= m) twice -= m;
+            value = twice >= f ? twice - f : twice + m - f;
+        }
+        results[key.index].value = value;
+    }
+    return results;
+}
+
+// ========== QUERY SERVER ==========
+// Lines are the batch format ("F n [m]", "L n [m]") plus "H n" (minimum
+// moves), "H n k" (k-th move of the 3-peg solution) and "STATS". Every
+// wakeup of the event loop gathers the complete lines of all ready clients,
+// answers repeats from the LRU cache, evaluates the remaining F/L queries
+// as one batch (sorted walks and SIMD lanes) and queues each client's
+// answers in request order. One thread serves every connection. A client is
+// only read while its unsent answers and unparsed input are under their
+// limits, so one that pipelines without reading its replies is held back by
+// the socket instead of growing the server's buffers.
+volatile sig_atomic_t server_stopping = 0;
+
+void stop_server(int) {
+    server_stopping = 1;
+}
+
+#ifdef DM_HAVE_EPOLL
+struct ServerConnection {
+    string input, output;
+    size_t written;
+    size_t pending; // requests read but not yet answered into output
+    bool closing;
+    
+    size_t unsent() const { return output.size() - written; }
+};
+
+// One request of the current wakeup; batch >= 0 points into the F/L batch
+struct ServerSlot {
+    int fd;
+    int batch;
+    string key, answer;
+};
+
+// Builds the Pisano contexts of moduli the server has not seen on a helper
+// thread, so factorising a new modulus never holds up the event loop; until
+// one is ready its queries are answered without reducing n. At most
+// SERVER_PISANO_QUEUE moduli wait, later ones are asked for again by their
+// next query.
+class PisanoBuilder {
+public:
+    PisanoBuilder() : stopping(false), worker(&PisanoBuilder::run, this) {}
+    ~PisanoBuilder();
+    
+    void request(vector<uint64_t>& moduli); // sorts and deduplicates moduli
+    
+private:
+    void run();
+    
+    mutex lock;
+    condition_variable wake;
+    deque<uint64_t> queue;
+    bool stopping;
+    thread worker;
+};
+
+PisanoBuilder::~PisanoBuilder() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void PisanoBuilder::request(vector<uint64_t>& moduli) {
+    sort(moduli.begin(), moduli.end());
+    moduli.erase(unique(moduli.begin(), moduli.end()), moduli.end());
+    lock_guard<mutex> guard(lock);
+    for (size_t i = 0; i < moduli.size() && queue.size() < SERVER_PISANO_QUEUE; i++) {
+        if (find(queue.begin(), queue.end(), moduli[i]) == queue.end()) queue.push_back(moduli[i]);
+    }
+    wake.notify_one();
+}
+
+void PisanoBuilder::run() {
+    unique_lock<mutex> guard(lock);
+    for (;;) {
+        wake.wait(guard, [this]() { return stopping || !queue.empty(); });
+        if (stopping) return;
+        uint64_t m = queue.front();
+        guard.unlock();
+        store_modular_context(ModularContext(m));
+        guard.lock();
+        queue.pop_front();
+    }
+}
+
+int open_server_socket(const string& address, string& error) {
+    int fd;
+    if (address.compare(0, 4, "tcp:") == 0) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(atoi(address.c_str() + 4)));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            error = "cannot bind 127.0.0.1:" + address.substr(4);
+            close(fd);
+            return -1;
+        }
+    } else {
+        sockaddr_un addr;
+        if (address.size() >= sizeof(addr.sun_path)) {
+            error = "socket path too long";
+            return -1;
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, address.c_str());
+        unlink(address.c_str());
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            error = "cannot bind " + address;
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, SOMAXCONN) != 0) {
+        error = "cannot listen on " + address;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool accepting_input(const ServerConnection& conn) {
+    return !conn.closing && conn.unsent() < SERVER_MAX_OUTPUT && conn.input.size() < SERVER_MAX_INPUT;
+}
+
+// A closing connection is done once nothing is left to answer or send
+bool connection_finished(const ServerConnection& conn) {
+    return conn.closing && conn.pending == 0 && conn.output.empty() && conn.input.find('\n') == string::npos;
+}
+
+// Writes as much queued output as the socket takes; EPOLLOUT is only
+// requested while something is left over, EPOLLIN while input is accepted.
+bool flush_connection(int epoll_fd, int fd, ServerConnection& conn) {
+    while (conn.written < conn.output.size()) {
+        ssize_t sent = send(fd, conn.output.data() + conn.written, conn.unsent(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            conn.input.clear();
+            conn.output.clear();
+            conn.written = 0;
+            conn.closing = true;
+            return false;
+        }
+        conn.written += sent;
+    }
+    if (conn.written == conn.output.size()) {
+        conn.output.clear();
+        conn.written = 0;
+    } else if (conn.written >= SERVER_MAX_OUTPUT) {
+        conn.output.erase(0, conn.written); // a client that keeps reading never drains fully
+        conn.written = 0;
+    }
+    epoll_event event;
+    event.events = (accepting_input(conn) ? static_cast<uint32_t>(EPOLLIN) : 0u)
+                 | (conn.output.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    return !connection_finished(conn);
+}
+
+int runServer(const string& address) {
+    string error;
+    int listen_fd = open_server_socket(address, error);
+    if (listen_fd < 0) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+    signal(SIGINT, stop_server);
+    signal(SIGTERM, stop_server);
+    
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    cerr << "Serving on " << address << " (lane kernel: " << lane_kernel_name() << ")" << endl;
+    
+    unordered_map<int, ServerConnection> connections;
+    LruCache cache(SERVER_CACHE_ENTRIES, SERVER_CACHE_BYTES);
+    PisanoBuilder pisano;
+    vector<uint64_t> unknown_moduli;
+    unsigned long long requests = 0;
+    vector<epoll_event> events(1024);
+    vector<ServerSlot> slots;
+    vector<BatchQuery> batch;
+    vector<int> closed;
+    vector<int> parse, backlog; // clients to take requests from; backlog still had some left
+    char buffer[1 << 16];
+    
+    while (!server_stopping) {
+        int ready = epoll_wait(epoll_fd, &events[0], static_cast<int>(events.size()), backlog.empty() ? -1 : 0);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        slots.clear();
+        batch.clear();
+        closed.clear();
+        parse.swap(backlog);
+        backlog.clear();
+        
+        for (int e = 0; e < ready; e++) {
+            int fd = events[e].data.fd;
+            if (fd == listen_fd) {
+                int client;
+                while ((client = accept4(listen_fd, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    ServerConnection conn = {string(), string(), 0, 0, false};
+                    connections[client] = conn;
+                    epoll_event client_event;
+                    client_event.events = EPOLLIN;
+                    client_event.data.fd = client;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client, &client_event);
+                }
+                continue;
+            }
+            
+            ServerConnection& conn = connections[fd];
+            if (events[e].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+                if (!flush_connection(epoll_fd, fd, conn)) closed.push_back(fd);
+            }
+            if ((events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !conn.closing) {
+                while (conn.input.size() < SERVER_MAX_INPUT) {
+                    ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+                    if (got > 0) {
+                        conn.input.append(buffer, got);
+                        continue;
+                    }
+                    if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) conn.closing = true;
+                    break;
+                }
+            }
+            parse.push_back(fd);
+        }
+        
+        // Clients whose answers are backed up wait for EPOLLOUT to drain them
+        sort(parse.begin(), parse.end());
+        parse.erase(unique(parse.begin(), parse.end()), parse.end());
+        for (size_t p = 0; p < parse.size(); p++) {
+            int fd = parse[p];
+            unordered_map<int, ServerConnection>::iterator it = connections.find(fd);
+            if (it == connections.end() || it->second.unsent() >= SERVER_MAX_OUTPUT) continue;
+            ServerConnection& conn = it->second;
+            
+            size_t start = 0, newline, taken = 0;
+            while (taken < SERVER_MAX_PIPELINE && (newline = conn.input.find('\n', start)) != string::npos) {
+                string line = conn.input.substr(start, newline - start);
+                start = newline + 1;
+                requests++;
+                
+                ServerSlot slot = {fd, -1, string(), string()};
+                size_t first = line.find_first_not_of(" \t\r");
+                char kind = first == string::npos ? 0 : static_cast<char>(toupper(line[first]));
+                if (kind == 'H') {
+                    slot.answer = answer_hanoi_query(line);
+                } else if (kind == 'S') {
+                    ostringstream stats;
+                    stats << "requests " << requests << " cache_hits " << cache.hits() << " cache_misses "
+                          << cache.misses() << " cached " << cache.size() << " cached_bytes " << cache.bytes()
+                          << " connections " << connections.size();
+                    slot.answer = stats.str();
+                } else {
+                    vector<BatchQuery> parsed = parseBatchQueries(line);
+                    if (parsed.size() == 1 && parsed[0].valid && parsed[0].modulus == 0
+                        && parsed[0].n > SERVER_MAX_EXACT_N) {
+                        slot.answer = "error: exact terms are served up to n = " + to_string(SERVER_MAX_EXACT_N)
+                                    + ", give a modulus";
+                    } else if (parsed.size() == 1 && parsed[0].valid) {
+                        slot.key = normalise_query(parsed[0]);
+                        if (!cache.get(slot.key, slot.answer)) {
+                            slot.batch = static_cast<int>(batch.size());
+                            batch.push_back(parsed[0]);
+                        }
+                    } else {
+                        slot.answer = "error: expected \"F n [m]\", \"L n [m]\", \"H n [k]\" or \"STATS\"";
+                    }
+                }
+                slots.push_back(slot);
+                conn.pending++;
+                taken++;
+            }
+            conn.input.erase(0, start);
+            if (taken == SERVER_MAX_PIPELINE && conn.input.find('\n') != string::npos) {
+                backlog.push_back(fd);
+            } else if (conn.input.size() > SERVER_MAX_LINE) {
+                ServerSlot slot = {fd, -1, string(), "error: line too long"};
+                slots.push_back(slot);
+                conn.pending++;
+                conn.input.clear();
+                conn.closing = true;
+            }
+            if (connection_finished(conn)) closed.push_back(fd);
+        }
+        
+        if (!batch.empty()) {
+            vector<string> texts;
+            vector<BatchResult> results = evaluateBatch(batch, texts, &unknown_moduli);
+            if (!unknown_moduli.empty()) {
+                pisano.request(unknown_moduli);
+                unknown_moduli.clear();
+            }
+            for (size_t i = 0; i < slots.size(); i++) {
+                if (slots[i].batch < 0) continue;
+                const BatchResult& result = results[slots[i].batch];
+                slots[i].answer = result.text >= 0 ? texts[result.text] : to_string(result.value);
+                cache.put(slots[i].key, slots[i].answer);
+            }
+        }
+        
+        for (size_t i = 0; i < slots.size(); i++) {
+            ServerConnection& conn = connections[slots[i].fd];
+            conn.output += slots[i].answer;
+            conn.output += '\n';
+            conn.pending--;
+        }
+        for (size_t p = 0; p < parse.size(); p++) {
+            unordered_map<int, ServerConnection>::iterator it = connections.find(parse[p]);
+            if (it != connections.end() && !flush_connection(epoll_fd, parse[p], it->second)) closed.push_back(parse[p]);
+        }
+        
+        sort(closed.begin(), closed.end());
+        closed.erase(unique(closed.begin(), closed.end()), closed.end());
+        for (size_t i = 0; i < closed.size(); i++) {
+            unordered_map<int, ServerConnection>::iterator it = connections.find(closed[i]);
+            if (it == connections.end()) continue;
+            if (!connection_finished(it->second)) continue;
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, closed[i], 0);
+            close(closed[i]);
+            connections.erase(it);
+        }
+    }
+    
+    for (unordered_map<int, ServerConnection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        close(it->first);
+    }
+    close(epoll_fd);
+    close(listen_fd);
+    if (address.compare(0, 4, "tcp:") != 0) unlink(address.c_str());
+    cerr << requests << " requests served, " << cache.hits() << " from the cache" << endl;
+    return 0;
+}
+#else
+int runServer(const string& address) {
+    (void)address;
+    cerr << "Error: the query server needs Linux (epoll)" << endl;
+    return 1;
+}
+#endif
+
+string answer_hanoi_query(const string& line) {
+    istringstream in(line);
+    string kind, k_text;
+    int n = 0;
+    in >> kind >> n;
+    if (!in || n < 1 || n > SERVER_MAX_HANOI_DISKS) {
+        return "error: expected \"H n\" or \"H n k\" with 1 <= n <= " + to_string(SERVER_MAX_HANOI_DISKS);
+    }
+    if (!(in >> k_text)) return hanoi_move_count_string(n);
+    
+    MoveCount k;
+    if (n > HANOI_MAX_WIDE_DISKS || !parse_u128(k_text, k) || k == 0 || k > hanoi_move_count(n)) {
+        return "error: k out of range";
+    }
+    HanoiMove move = hanoi_kth_move(n, k);
+    return to_string(move.disk) + " " + static_cast<char>('A' + move.from) + " " + static_cast<char>('A' + move.to);
+}
+
+string normalise_query(const BatchQuery& query) {
+    return string(query.lucas ? "L " : "F ") + to_string(query.n) + " " + to_string(query.modulus);
+}
+
+bool LruCache::get(const string& key, string& value) {
+    unordered_map<string, Entries::iterator>::iterator it = index.find(key);
+    if (it == index.end()) {
+        miss_count++;
+        return false;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    value = it->second->second;
+    hit_count++;
+    return true;
+}
+
+void LruCache::put(const string& key, const string& value) {
+    unordered_map<string, Entries::iterator>::iterator it = index.find(key);
+    if (it != index.end()) {
+        held_bytes -= it->second->first.size() + it->second->second.size();
+        entries.erase(it->second);
+        index.erase(it);
+    }
+    if (key.size() + value.size() > max_bytes) return;
+    
+    entries.push_front(make_pair(key, value));
+    index[key] = entries.begin();
+    held_bytes += key.size() + value.size();
+    while (index.size() > capacity || held_bytes > max_bytes) {
+        held_bytes -= entries.back().first.size() + entries.back().second.size();
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+// ========== SIMD LANE KERNELS ==========
+// Runs many independent modular fast-doubling chains in lockstep, one per
+// lane, walking the bits of all n together from the highest bit present.
+// Lanes whose n is shorter simply start with leading zero bits, which keep
+// (F(0), F(1)) fixed. The kernel is chosen once from the CPU features, and
+// DM_SIMD=scalar|avx2|avx512 in the environment forces a particular one.
+enum LaneKernel { LANES_SCALAR, LANES_AVX2, LANES_AVX512 };
+
+static LaneKernel select_lane_kernel() {
+    const char* forced = getenv("DM_SIMD");
+    string choice = forced ? forced : "";
+#ifdef DM_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    bool avx512 = __builtin_cpu_supports("avx512f");
+    bool avx2 = __builtin_cpu_supports("avx2");
+    if (choice == "scalar") return LANES_SCALAR;
+    if (choice == "avx2") return avx2 ? LANES_AVX2 : LANES_SCALAR;
+    if (avx512) return LANES_AVX512;
+    if (avx2) return LANES_AVX2;
+#endif
+    return LANES_SCALAR;
+}
+
+static LaneKernel lane_kernel() {
+    static LaneKernel kernel = select_lane_kernel();
+    return kernel;
+}
+
+const char* lane_kernel_name() {
+    switch (lane_kernel()) {
+        case LANES_AVX512: return "avx512, 16 lanes";
+        case LANES_AVX2: return "avx2, 8 lanes";
+        default: return "scalar";
+    }
+}
+
+void fibonacci_pairs_mod_lanes(vector<LaneJob>& jobs) {
+    if (jobs.empty()) return;
+    switch (lane_kernel()) {
+#ifdef DM_HAVE_X86_SIMD
+        case LANES_AVX512:
+            fibonacci_pairs_mod_avx512(jobs.data(), jobs.size());
+            break;
+        case LANES_AVX2:
+            fibonacci_pairs_mod_avx2(jobs.data(), jobs.size());
+            break;
+#endif
+        default:
+            fibonacci_pairs_mod_scalar(jobs.data(), jobs.size());
+    }
+}
+
+void fibonacci_pairs_mod_scalar(LaneJob* jobs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        pair<uint64_t, uint64_t> f = fibonacci_pair_mod(jobs[i].n, Montgomery64(jobs[i].modulus));
+        jobs[i].f = f.first;
+        jobs[i].f1 = f.second;
+    }
+}
+
+// Per-lane constants for 32-bit Montgomery arithmetic (R = 2^32)
+static uint32_t lane_neg_inverse(uint32_t m) {
+    uint32_t inv = m;
+    for (int i = 0; i < 4; i++) inv *= 2 - m * inv;
+    return 0 - inv;
+}
+
+static int highest_bit(const LaneJob* jobs, size_t count) {
+    uint64_t all = 0;
+    for (size_t i = 0; i < count; i++) all |= jobs[i].n;
+    return all == 0 ? -1 : 63 - __builtin_clzll(all);
+}
+
+#ifdef DM_HAVE_X86_SIMD
+// Each 64-bit lane holds one 32-bit residue. Products come from mul_epu32,
+// and t = (T + q m) / 2^32 stays below 2m because m < 2^31.
+__attribute__((target("avx2")))
+static inline __m256i lane_reduce_avx2(__m256i t, __m256i m) {
+    return _mm256_sub_epi64(t, _mm256_andnot_si256(_mm256_cmpgt_epi64(m, t), m));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i lane_mul_avx2(__m256i a, __m256i b, __m256i m, __m256i m_inv) {
+    __m256i t = _mm256_mul_epu32(a, b);
+    __m256i q = _mm256_mul_epu32(t, m_inv);
+    t = _mm256_srli_epi64(_mm256_add_epi64(t, _mm256_mul_epu32(q, m)), 32);
+    return lane_reduce_avx2(t, m);
+}
+
+__attribute__((target("avx2")))
+void fibonacci_pairs_mod_avx2(LaneJob* jobs, size_t count) {
+    const size_t VECTORS = 2, LANES = 4 * VECTORS;
+    const __m256i one = _mm256_set1_epi64x(1);
+    
+    for (size_t base = 0; base < count; base += LANES) {
+        size_t lanes = min(LANES, count - base);
+        LaneJob* group = jobs + base;
+        
+        alignas(32) uint64_t n[LANES], m[LANES], m_inv[LANES], r1[LANES];
+        for (size_t i = 0; i < LANES; i++) {
+            const LaneJob& job = group[i < lanes ? i : 0];
+            n[i] = job.n;
+            m[i] = job.modulus;
+            m_inv[i] = lane_neg_inverse(job.modulus);
+            r1[i] = (1ULL << 32) % job.modulus; // Montgomery form of 1
+        }
+        
+        __m256i vn[VECTORS], vm[VECTORS], vinv[VECTORS], a[VECTORS], b[VECTORS];
+        for (size_t v = 0; v < VECTORS; v++) {
+            vn[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(n + 4 * v));
+            vm[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(m + 4 * v));
+            vinv[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_inv + 4 * v));
+            a[v] = _mm256_setzero_si256();
+            b[v] = _mm256_load_si256(reinterpret_cast<const __m256i*>(r1 + 4 * v));
+        }
+        
+        for (int bit = highest_bit(group, lanes); bit >= 0; bit--) {
+            __m256i shift = _mm256_set1_epi64x(bit);
+            for (size_t v = 0; v < VECTORS; v++) {
+                // c = a(2b - a), d = a^2 + b^2
+                __m256i twice_b = lane_reduce_avx2(_mm256_add_epi64(b[v], b[v]), vm[v]);
+                __m256i diff = lane_reduce_avx2(_mm256_sub_epi64(_mm256_add_epi64(twice_b, vm[v]), a[v]), vm[v]);
+                __m256i c = lane_mul_avx2(a[v], diff, vm[v], vinv[v]);
+                __m256i d = lane_reduce_avx2(_mm256_add_epi64(lane_mul_avx2(a[v], a[v], vm[v], vinv[v]),
+                                                              lane_mul_avx2(b[v], b[v], vm[v], vinv[v])), vm[v]);
+                __m256i c_plus_d = lane_reduce_avx2(_mm256_add_epi64(c, d), vm[v]);
+                
+                __m256i set = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_srlv_epi64(vn[v], shift), one), one);
+                a[v] = _mm256_blendv_epi8(c, d, set);
+                b[v] = _mm256_blendv_epi8(d, c_plus_d, set);
+            }
+        }
+        
+        alignas(32) uint64_t fa[LANES], fb[LANES];
+        for (size_t v = 0; v < VECTORS; v++) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(fa + 4 * v), lane_mul_avx2(a[v], one, vm[v], vinv[v]));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(fb + 4 * v), lane_mul_avx2(b[v], one, vm[v], vinv[v]));
+        }
+        for (size_t i = 0; i < lanes; i++) {
+            group[i].f = fa[i];
+            group[i].f1 = fb[i];
+        }
+    }
+}
+
+// GCC 12 reports a false -Wmaybe-uninitialized inside _mm512_mul_epu32
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f")))
+static inline __m512i lane_reduce_avx512(__m512i t, __m512i m) {
+    return _mm512_mask_sub_epi64(t, _mm512_cmpge_epu64_mask(t, m), t, m);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i lane_mul_avx512(__m512i a, __m512i b, __m512i m, __m512i m_inv) {
+    __m512i t = _mm512_mul_epu32(a, b);
+    __m512i q = _mm512_mul_epu32(t, m_inv);
+    t = _mm512_srli_epi64(_mm512_add_epi64(t, _mm512_mul_epu32(q, m)), 32);
+    return lane_reduce_avx512(t, m);
+}
+
+__attribute__((target("avx512f")))
+void fibonacci_pairs_mod_avx512(LaneJob* jobs, size_t count) {
+    const size_t VECTORS = 2, LANES = 8 * VECTORS;
+    const __m512i one = _mm512_set1_epi64(1);
+    
+    for (size_t base = 0; base < count; base += LANES) {
+        size_t lanes = min(LANES, count - base);
+        LaneJob* group = jobs + base;
+        
+        alignas(64) uint64_t n[LANES], m[LANES], m_inv[LANES], r1[LANES];
+        for (size_t i = 0; i < LANES; i++) {
+            const LaneJob& job = group[i < lanes ? i : 0];
+            n[i] = job.n;
+            m[i] = job.modulus;
+            m_inv[i] = lane_neg_inverse(job.modulus);
+            r1[i] = (1ULL << 32) % job.modulus; // Montgomery form of 1
+        }
+        
+        __m512i vn[VECTORS], vm[VECTORS], vinv[VECTORS], a[VECTORS], b[VECTORS];
+        for (size_t v = 0; v < VECTORS; v++) {
+            vn[v] = _mm512_load_si512(n + 8 * v);
+            vm[v] = _mm512_load_si512(m + 8 * v);
+            vinv[v] = _mm512_load_si512(m_inv + 8 * v);
+            a[v] = _mm512_setzero_si512();
+            b[v] = _mm512_load_si512(r1 + 8 * v);
+        }
+        
+        for (int bit = highest_bit(group, lanes); bit >= 0; bit--) {
+            __m512i shift = _mm512_set1_epi64(bit);
+            for (size_t v = 0; v < VECTORS; v++) {
+                // c = a(2b - a), d = a^2 + b^2
+                __m512i twice_b = lane_reduce_avx512(_mm512_add_epi64(b[v], b[v]), vm[v]);
+                __m512i diff = lane_reduce_avx512(_mm512_sub_epi64(_mm512_add_epi64(twice_b, vm[v]), a[v]), vm[v]);
+                __m512i c = lane_mul_avx512(a[v], diff, vm[v], vinv[v]);
+                __m512i d = lane_reduce_avx512(_mm512_add_epi64(lane_mul_avx512(a[v], a[v], vm[v], vinv[v]),
+                                                                lane_mul_avx512(b[v], b[v], vm[v], vinv[v])), vm[v]);
+                __m512i c_plus_d = lane_reduce_avx512(_mm512_add_epi64(c, d), vm[v]);
+                
+                __mmask8 set = _mm512_test_epi64_mask(_mm512_srlv_epi64(vn[v], shift), one);
+                a[v] = _mm512_mask_blend_epi64(set, c, d);
+                b[v] = _mm512_mask_blend_epi64(set, d, c_plus_d);
+            }
+        }
+        
+        alignas(64) uint64_t fa[LANES], fb[LANES];
+        for (size_t v = 0; v < VECTORS; v++) {
+            _mm512_store_si512(fa + 8 * v, lane_mul_avx512(a[v], one, vm[v], vinv[v]));
+            _mm512_store_si512(fb + 8 * v, lane_mul_avx512(b[v], one, vm[v], vinv[v]));
+        }
+        for (size_t i = 0; i < lanes; i++) {
+            group[i].f = fa[i];
+            group[i].f1 = fb[i];
+        }
+    }
+}
+
+#pragma GCC diagnostic pop
+#endif
+
+// ========== NUMBER THEORY ==========
+uint64_t mulmod_u64(uint64_t a, uint64_t b, uint64_t m) {
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(a) * b % m);
+}
+
+uint64_t powmod_u64(uint64_t base, uint64_t exp, uint64_t m) {
+    uint64_t result = 1 % m;
+    base %= m;
+    while (exp > 0) {
+        if (exp & 1) result = mulmod_u64(result, base, m);
+        base = mulmod_u64(base, base, m);
+        exp >>= 1;
+    }
+    return result;
+}
+
+// Deterministic Miller-Rabin for all 64-bit n
+bool is_prime_u64(uint64_t n) {
+    if (n < 2) return false;
+    const uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    for (uint64_t p : bases) {
+        if (n % p == 0) return n == p;
+    }
+    
+    uint64_t d = n - 1;
+    int s = 0;
+    while (d % 2 == 0) {
+        d /= 2;
+        s++;
+    }
+    
+    for (uint64_t a : bases) {
+        uint64_t x = powmod_u64(a, d, n);
+        if (x == 1 || x == n - 1) continue;
+        bool composite = true;
+        for (int r = 1; r < s && composite; r++) {
+            x = mulmod_u64(x, x, n);
+            if (x == n - 1) composite = false;
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+// Pollard-Brent: returns a non-trivial factor of the odd composite n
+uint64_t pollard_rho(uint64_t n) {
+    for (uint64_t c = 1;; c++) {
+        uint64_t x = 2, y = 2, product = 1, factor = 1;
+        uint64_t saved_y = y;
+        for (uint64_t r = 1; factor == 1; r *= 2) {
+            x = y;
+            for (uint64_t i = 0; i < r; i++) y = (mulmod_u64(y, y, n) + c) % n;
+            for (uint64_t k = 0; k < r && factor == 1; k += 128) {
+                saved_y = y;
+                for (uint64_t i = 0; i < 128 && i < r - k; i++) {
+                    y = (mulmod_u64(y, y, n) + c) % n;
+                    product = mulmod_u64(product, x > y ? x - y : y - x, n);
+                }
+                factor = __gcd(product, n);
+            }
+        }
+        if (factor == n) {
+            // Batched gcd overshot: retrace one step at a time
+            do {
+                saved_y = (mulmod_u64(saved_y, saved_y, n) + c) % n;
+                factor = __gcd(x > saved_y ? x - saved_y : saved_y - x, n);
+            } while (factor == 1);
+        }
+        if (factor != n) return factor;
+    }
+}
+
+// Prime factorisation as (prime, exponent) pairs in increasing prime order
+vector<pair<uint64_t, int>> factorize(uint64_t n) {
+    vector<uint64_t> primes;
+    for (uint64_t p = 2; p < 1000 && p * p <= n; p++) {
+        while (n % p == 0) {
+            primes.push_back(p);
+            n /= p;
+        }
+    }
+    
+    vector<uint64_t> pending;
+    if (n > 1) pending.push_back(n);
+    while (!pending.empty()) {
+        uint64_t x = pending.back();
+        pending.pop_back();
+        if (is_prime_u64(x)) {
+            primes.push_back(x);
+            continue;
+        }
+        uint64_t factor = pollard_rho(x);
+        pending.push_back(factor);
+        pending.push_back(x / factor);
+    }
+    
+    sort(primes.begin(), primes.end());
+    vector<pair<uint64_t, int>> factors;
+    for (size_t i = 0; i < primes.size(); i++) {
+        if (!factors.empty() && factors.back().first == primes[i]) factors.back().second++;
+        else factors.push_back(make_pair(primes[i], 1));
+    }
+    return factors;
+}
+
+unsigned __int128 gcd_u128(unsigned __int128 a, unsigned __int128 b) {
+    while (b != 0) {
+        unsigned __int128 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+string u128_to_string(unsigned __int128 value) {
+    if (value == 0) return "0";
+    string digits;
+    while (value > 0) {
+        digits += static_cast<char>('0' + static_cast<int>(value % 10));
+        value /= 10;
+    }
+    reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+// ========== LUCAS SEQUENCES AND PRIMALITY ==========
+// U_n(P, Q) and V_n(P, Q) satisfy x(n) = P x(n-1) - Q x(n-2) with U_0 = 0,
+// U_1 = 1, V_0 = 2, V_1 = P; Fibonacci and Lucas numbers are P = 1, Q = -1.
+// Baillie-PSW combines a strong base-2 Miller-Rabin test with a strong Lucas
+// test using Selfridge's parameters; no composite passing both is known, and
+// none exists below 2^64.
+void primalityMenu() {
+    int choice;
+    do {
+        clearScreen();
+        displayHeader("LUCAS SEQUENCES AND PRIMALITY");
+        
+        cout << "1. Lucas sequence terms U_n(P, Q), V_n(P, Q) modulo m" << endl;
+        cout << "2. Test a number for primality (Baillie-PSW, any size)" << endl;
+        cout << "3. Scan a 64-bit range for primes (all threads)" << endl;
+        cout << "0. Back to main menu" << endl;
+        cout << "Enter your choice: ";
+        cin >> choice;
+        
+        switch (choice) {
+            case 0: break;
+            case 1: lucasSequenceQuery(); break;
+            case 2: primalityTestQuery(); break;
+            case 3: primeRangeScan(); break;
+            default: cout << "Invalid choice!" << endl;
+        }
+        if (choice != 0) pressEnterToContinue();
+    } while (choice != 0);
+}
+
+void lucasSequenceQuery() {
+    unsigned long long n;
+    long long p, q;
+    uint64_t m;
+    cout << "Enter n: ";
+    cin >> n;
+    cout << "Enter P and Q: ";
+    cin >> p >> q;
+    cout << "Enter modulus m (1-" << MAX_MODULUS << "): ";
+    cin >> m;
+    if (!cin || m < 1 || m > MAX_MODULUS) {
+        cout << "Error: modulus out of range!" << endl;
+        return;
+    }
+    
+    auto start = high_resolution_clock::now();
+    pair<uint64_t, uint64_t> uv = lucas_uv_mod(n, p, q, m);
+    auto elapsed = duration_cast<microseconds>(high_resolution_clock::now() - start);
+    cout << "\nU_" << n << "(" << p << ", " << q << ") mod " << m << " = " << uv.first << endl;
+    cout << "V_" << n << "(" << p << ", " << q << ") mod " << m << " = " << uv.second << endl;
+    cout << "Computed in " << elapsed.count() << " us" << endl;
+}
+
+void primalityTestQuery() {
+    string text;
+    cout << "Enter a non-negative integer: ";
+    cin >> text;
+    BigInt n;
+    if (!parse_big(text, n)) {
+        cout << "Error: not a non-negative integer!" << endl;
+        return;
+    }
+    
+    auto start = high_resolution_clock::now();
+    bool prime = is_prime_bpsw(n);
+    auto elapsed = duration_cast<microseconds>(high_resolution_clock::now() - start);
+    cout << "\nThe " << text.length() << "-digit number is " << (prime ? "a probable prime (passes BPSW)" : "composite") << endl;
+    if (prime && n.bitLength() <= 64) cout << "Below 2^64 BPSW is exact: it is prime." << endl;
+    cout << "Tested in " << elapsed.count() << " us" << endl;
+}
+
+void primeRangeScan() {
+    uint64_t first, count;
+    cout << "Enter the first candidate: ";
+    cin >> first;
+    cout << "Enter how many numbers to test: ";
+    cin >> count;
+    if (!cin || count == 0 || first + count < first) {
+        cout << "Error: invalid range!" << endl;
+        return;
+    }
+    
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    uint64_t blocks = (count + PRIME_SCAN_BLOCK - 1) / PRIME_SCAN_BLOCK;
+    atomic<uint64_t> next_block(0), primes(0);
+    auto start = high_resolution_clock::now();
+    vector<thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.push_back(thread([&]() {
+            uint64_t found = 0;
+            for (uint64_t block = next_block++; block < blocks; block = next_block++) {
+                uint64_t begin = first + block * PRIME_SCAN_BLOCK;
+                uint64_t end = begin + min(PRIME_SCAN_BLOCK, count - block * PRIME_SCAN_BLOCK);
+                for (uint64_t n = begin; n != end; n++) found += is_prime_bpsw(n);
+            }
+            primes += found;
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+    double seconds = duration<double>(high_resolution_clock::now() - start).count();
+    
+    cout << "\n" << primes.load() << " primes in [" << first << ", " << first + count - 1 << "]" << endl;
+    cout << fixed << setprecision(3) << seconds * 1000 << " ms on " << threads << " thread(s), "
+         << setprecision(2) << count / seconds / 1e6 << " million candidates per second" << endl;
+    cout.unsetf(ios::fixed);
+}
+
+// U_n and V_n mod m for any modulus. The halving ladder below needs m odd,
+// so this uses the division-free pair (U_k, U_k+1) instead, with
+// V_n = 2U_n+1 - P U_n.
+pair<uint64_t, uint64_t> lucas_uv_mod(unsigned long long n, long long p, long long q, uint64_t m) {
+    if (m == 1) return make_pair(0, 0);
+    if (m % 2 == 1) {
+        Montgomery64 arith(m);
+        pair<uint64_t, uint64_t> u = lucas_u_pair(n, p, q, arith);
+        uint64_t v = arith.sub(arith.add(u.second, u.second), arith.mul(arith_int(arith, p), u.first));
+        return make_pair(arith.fromForm(u.first), arith.fromForm(v));
+    }
+    Barrett64 arith(m);
+    pair<uint64_t, uint64_t> u = lucas_u_pair(n, p, q, arith);
+    uint64_t v = arith.sub(arith.add(u.second, u.second), arith.mul(arith_int(arith, p), u.first));
+    return make_pair(u.first, v);
+}
+
+// Signed small integers into the arithmetic's representation
+template <class Arith>
+typename Arith::Value arith_int(const Arith& arith, long long x) {
+    if (x >= 0) return arith.toForm(static_cast<uint64_t>(x));
+    return arith.sub(arith.toForm(static_cast<uint64_t>(0)), arith.toForm(0 - static_cast<uint64_t>(x)));
+}
+
+inline int exponent_top_bit(uint64_t e) { return e ? 63 - __builtin_clzll(e) : -1; }
+inline bool exponent_bit(uint64_t e, int bit) { return (e >> bit) & 1; }
+inline int exponent_top_bit(const Limbs& e) { return e.empty() ? -1 : static_cast<int>(e.size() * 32 - __builtin_clz(e.back())) - 1; }
+inline bool exponent_bit(const Limbs& e, int bit) { return (e[bit / 32] >> (bit % 32)) & 1; }
+
+//   U_2k   = U_k (2U_k+1 - P U_k)
+//   U_2k+1 = U_k+1^2 - Q U_k^2
+//   U_2k+2 = P U_2k+1 - Q U_2k
+template <class Arith>
+pair<typename Arith::Value, typename Arith::Value> lucas_u_pair(unsigned long long n, long long p, long long q,
+                                                                const Arith& arith) {
+    typedef typename Arith::Value Value;
+    Value P = arith_int(arith, p), Q = arith_int(arith, q);
+    Value a = arith_int(arith, 0), b = arith_int(arith, 1); // U_0, U_1
+    for (int bit = exponent_top_bit(static_cast<uint64_t>(n)); bit >= 0; bit--) {
+        Value c = arith.mul(a, arith.sub(arith.add(b, b), arith.mul(P, a)));
+        Value d = arith.sub(arith.mul(b, b), arith.mul(Q, arith.mul(a, a)));
+        if ((n >> bit) & 1) {
+            a = d;
+            b = arith.sub(arith.mul(P, d), arith.mul(Q, c));
+        } else {
+            a = c;
+            b = d;
+        }
+    }
+    return make_pair(a, b);
+}
+
+// U_n, V_n and Q^n modulo an odd m, walking the bits of n from the top:
+//   U_2k = U_k V_k                    V_2k   = V_k^2 - 2Q^k
+//   U_2k+1 = (P U_2k + V_2k) / 2      V_2k+1 = (D U_2k + P V_2k) / 2
+// with D = P^2 - 4Q. Halving mod an odd m is a shift, plus m when odd.
+template <class Arith, class Exponent>
+void lucas_uv_ladder(const Arith& arith, const Exponent& n, long long p, long long q,
+                     typename Arith::Value& u, typename Arith::Value& v, typename Arith::Value& qk) {
+    typedef typename Arith::Value Value;
+    Value P = arith_int(arith, p), Q = arith_int(arith, q), D = arith_int(arith, p * p - 4 * q);
+    u = arith_int(arith, 0);
+    v = arith_int(arith, 2);
+    qk = arith_int(arith, 1);
+    
+    for (int bit = exponent_top_bit(n); bit >= 0; bit--) {
+        // Double: k -> 2k
+        u = arith.mul(u, v);
+        v = arith.sub(arith.mul(v, v), arith.add(qk, qk));
+        qk = arith.mul(qk, qk);
+        
+        // Step: 2k -> 2k + 1 (P = 1 skips two multiplications)
+        if (exponent_bit(n, bit)) {
+            Value pu = p == 1 ? u : arith.mul(P, u);
+            Value pv = p == 1 ? v : arith.mul(P, v);
+            Value u1 = arith.half(arith.add(pu, v));
+            v = arith.half(arith.add(arith.mul(D, u), pv));
+            u = u1;
+            qk = arith.mul(qk, Q);
+        }
+    }
+}
+
+// n - 1 = d 2^s. Base 2 lets the ladder double with an addition instead of
+// multiplying by the base.
+template <class Arith, class Exponent>
+bool strong_probable_prime_base2(const Arith& arith, const Exponent& d, int s) {
+    typedef typename Arith::Value Value;
+    Value one = arith_int(arith, 1), minus_one = arith_int(arith, -1);
+    Value x = one;
+    for (int bit = exponent_top_bit(d); bit >= 0; bit--) {
+        x = arith.mul(x, x);
+        if (exponent_bit(d, bit)) x = arith.add(x, x);
+    }
+    if (x == one || x == minus_one) return true;
+    for (int r = 1; r < s; r++) {
+        x = arith.mul(x, x);
+        if (x == minus_one) return true;
+        if (x == one) return false;
+    }
+    return false;
+}
+
+// n + 1 = d 2^s. n is a strong Lucas probable prime when U_d = 0 or
+// V_(d 2^r) = 0 for some 0 <= r < s (P = 1, Q = (1 - D) / 4).
+template <class Arith, class Exponent>
+bool strong_lucas_probable_prime(const Arith& arith, const Exponent& d, int s, long long discriminant) {
+    typedef typename Arith::Value Value;
+    const Value zero = Value();
+    Value u, v, qk;
+    lucas_uv_ladder(arith, d, 1, (1 - discriminant) / 4, u, v, qk);
+    if (u == zero || v == zero) return true;
+    for (int r = 1; r < s; r++) {
+        v = arith.sub(arith.mul(v, v), arith.add(qk, qk));
+        if (v == zero) return true;
+        qk = arith.mul(qk, qk);
+    }
+    return false;
+}
+
+// First D in 5, -7, 9, -11, ... with Jacobi (D/n) = -1, or 0 when the
+// search proves n composite (a shared factor, or n a perfect square, for
+// which no such D exists). n must be odd and larger than the trial primes.
+template <class Number>
+long long selfridge_discriminant(const Number& n) {
+    for (long long d = 5;; d = d > 0 ? -(d + 2) : 2 - d) {
+        int symbol = jacobi_symbol(d, n);
+        if (symbol == -1) return d;
+        if (symbol == 0) return 0;
+        if (d == 13 && is_square(n)) return 0;
+    }
+}
+
+int jacobi_symbol(long long a, uint64_t n) {
+    uint64_t x = a >= 0 ? static_cast<uint64_t>(a) % n : (n - (0 - static_cast<uint64_t>(a)) % n) % n;
+    int result = 1;
+    while (x != 0) {
+        while (x % 2 == 0) {
+            x /= 2;
+            if (n % 8 == 3 || n % 8 == 5) result = -result;
+        }
+        swap(x, n);
+        if (x % 4 == 3 && n % 4 == 3) result = -result;
+        x %= n;
+    }
+    return n == 1 ? result : 0;
+}
+
+// For small a only: splits off the sign and factors of two, then flips
+// (|a| / n) into (n mod |a| / |a|) by quadratic reciprocity.
+int jacobi_symbol(long long a, const BigInt& n) {
+    unsigned long long n8 = n.mod(8);
+    uint64_t x = a >= 0 ? static_cast<uint64_t>(a) : 0 - static_cast<uint64_t>(a);
+    int result = (a < 0 && n8 % 4 == 3) ? -1 : 1;
+    if (x == 0) return 0;
+    while (x % 2 == 0) {
+        x /= 2;
+        if (n8 == 3 || n8 == 5) result = -result;
+    }
+    if (x == 1) return result;
+    if (x % 4 == 3 && n8 % 4 == 3) result = -result;
+    return result * jacobi_symbol(static_cast<long long>(n.mod(x)), x);
+}
+
+bool is_square(uint64_t n) {
+    uint64_t r = static_cast<uint64_t>(sqrtl(static_cast<long double>(n)));
+    while (static_cast<unsigned __int128>(r) * r > n) r--;
+    while (static_cast<unsigned __int128>(r + 1) * (r + 1) <= n) r++;
+    return static_cast<unsigned __int128>(r) * r == n;
+}
+
+bool is_square(const BigInt& n) {
+    Limbs root = limbs_isqrt(n.limbs);
+    return limbs_compare(limbs_mul(root, root), n.limbs) == 0;
+}
+
+const uint32_t BPSW_TRIAL_PRIMES[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97};
+
+bool is_prime_bpsw(uint64_t n) {
+    if (n < 2) return false;
+    for (uint32_t p : BPSW_TRIAL_PRIMES) {
+        if (n % p == 0) return n == p;
+    }
+    if (n < 101 * 101) return true;
+    
+    Montgomery64 arith(n);
+    int s = __builtin_ctzll(n - 1);
+    if (!strong_probable_prime_base2(arith, (n - 1) >> s, s)) return false;
+    long long discriminant = selfridge_discriminant(n);
+    if (discriminant == 0) return false;
+    // n + 1 cannot overflow: 2^64 - 1 is divisible by 3
+    s = __builtin_ctzll(n + 1);
+    return strong_lucas_probable_prime(arith, (n + 1) >> s, s, discriminant);
+}
+
+bool is_prime_bpsw(const BigInt& n) {
+    if (n.limbs.size() <= 2) {
+        uint64_t small = 0;
+        for (size_t i = n.limbs.size(); i-- > 0;) small = (small << 32) | n.limbs[i];
+        return is_prime_bpsw(small);
+    }
+    for (uint32_t p = 2; p < 1000; p++) {
+        if (is_prime_bpsw(static_cast<uint64_t>(p)) && n.mod(p) == 0) return false;
+    }
+    
+    MontgomeryBig arith(n.limbs);
+    BigInt d = n - BigInt(1);
+    int s = 0;
+    while (!(d.limbs[s / 32] >> (s % 32) & 1)) s++;
+    d >>= s;
+    if (!strong_probable_prime_base2(arith, d.limbs, s)) return false;
+    long long discriminant = selfridge_discriminant(n);
+    if (discriminant == 0) return false;
+    d = n + BigInt(1);
+    s = 0;
+    while (!(d.limbs[s / 32] >> (s % 32) & 1)) s++;
+    d >>= s;
+    return strong_lucas_probable_prime(arith, d.limbs, s, discriminant);
+}
+
+// Batch primality: one integer per line, answered "prime" or "composite"
+// in input order. The input is cut at line boundaries into chunks that
+// worker threads claim from a shared counter; 64-bit candidates take the
+// Montgomery64 path, longer ones the MontgomeryBig path.
+int runPrimeBatch(const char* path, unsigned threads) {
+    string input;
+    if (!readAllInput(path, input)) {
+        cerr << "Error: cannot read " << path << endl;
+        return 1;
+    }
+    
+    auto start = high_resolution_clock::now();
+    vector<size_t> bounds(1, 0);
+    while (bounds.back() < input.size()) {
+        size_t cut = min(input.size(), bounds.back() + PRIME_BATCH_CHUNK_BYTES);
+        while (cut < input.size() && input[cut - 1] != '\n') cut++;
+        bounds.push_back(cut);
+    }
+    
+    size_t chunks = bounds.size() - 1;
+    vector<string> outputs(chunks);
+    atomic<size_t> next_chunk(0), tested(0);
+    vector<thread> workers;
+    for (unsigned t = 0; t < min<size_t>(threads, max<size_t>(chunks, 1)); t++) {
+        workers.push_back(thread([&]() {
+            for (size_t chunk = next_chunk++; chunk < chunks; chunk = next_chunk++) {
+                tested += test_prime_lines(input.data() + bounds[chunk], input.data() + bounds[chunk + 1], outputs[chunk]);
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+    
+    for (size_t chunk = 0; chunk < chunks; chunk++) fwrite(outputs[chunk].data(), 1, outputs[chunk].size(), stdout);
+    fflush(stdout);
+    double seconds = duration<double>(high_resolution_clock::now() - start).count();
+    cerr << tested.load() << " candidates tested in " << static_cast<long long>(seconds * 1000) << " ms ("
+         << static_cast<long long>(tested.load() / max(seconds, 1e-9)) << " per second, " << workers.size()
+         << " thread(s))" << endl;
+    return 0;
+}
+
+// Answers every line in [begin, end); returns the number of candidates
+size_t test_prime_lines(const char* begin, const char* end, string& out) {
+    size_t tested = 0;
+    while (begin < end) {
+        const char* line_end = static_cast<const char*>(memchr(begin, '\n', end - begin));
+        if (!line_end) line_end = end;
+        const char* first = begin;
+        const char* last = line_end;
+        begin = line_end + 1;
+        while (first < last && isspace(static_cast<unsigned char>(*first))) first++;
+        while (last > first && isspace(static_cast<unsigned char>(last[-1]))) last--;
+        if (first == last || *first == '#') continue;
+        
+        tested++;
+        uint64_t n;
+        from_chars_result parsed = from_chars(first, last, n);
+        if (parsed.ec == errc() && parsed.ptr == last) {
+            out += is_prime_bpsw(n) ? "prime\n" : "composite\n";
+            continue;
+        }
+        BigInt big;
+        if (parsed.ec == errc::result_out_of_range && parse_big(string(first, last), big)) {
+            out += is_prime_bpsw(big) ? "prime\n" : "composite\n";
+            continue;
+        }
+        out += "error: expected a non-negative integer\n";
+    }
+    return tested;
+}
+
+// ========== FIBONACCI CODING ==========
+void fibonacciCodingMenu() {
+    unsigned long long n;
+    cout << "Enter a number to decompose: ";
+    cin >> n;
+    
+    vector<int> parts = zeckendorf(n);
+    const vector<uint64_t>& fib = fibonacci_code_tables().terms;
+    cout << "\nZeckendorf representation: " << n;
+    for (size_t i = 0; i < parts.size(); i++) cout << (i ? " + " : " = ") << "F(" << parts[i] << ")";
+    for (size_t i = 0; i < parts.size(); i++) cout << (i ? " + " : " = ") << fib[parts[i] - 2];
+    cout << endl;
+    
+    BitWriter writer;
+    fibonacci_encode(n, writer);
+    BitReader reader(writer.words(), writer.size());
+    cout << "Fibonacci code (digits of n + 1, lowest first): ";
+    while (!reader.done()) cout << reader.read(1);
+    cout << " (" << writer.size() << " bits)" << endl;
+    
+    cout << "\nBenchmarking against varint, " << CODEC_BENCH_VALUES << " values per distribution..." << endl;
+    runCodecBenchmark(CODEC_BENCH_VALUES);
+}
+
+void BitWriter::write(uint64_t value, int count) {
+    if (count == 0) return;
+    if (count < 64) value &= (1ULL << count) - 1;
+    int offset = static_cast<int>(bits & 63);
+    if (offset == 0) {
+        data.push_back(value);
+    } else {
+        data.back() |= value << offset;
+        if (offset + count > 64) data.push_back(value >> (64 - offset));
+    }
+    bits += count;
+}
+
+uint64_t BitReader::peek() const {
+    size_t word = pos >> 6;
+    int offset = static_cast<int>(pos & 63);
+    uint64_t value = word < word_count ? data[word] >> offset : 0;
+    if (offset != 0 && word + 1 < word_count) value |= data[word + 1] << (64 - offset);
+    return value;
+}
+
+uint64_t BitReader::read(int count) {
+    uint64_t value = peek();
+    if (count < 64) value &= (1ULL << count) - 1;
+    pos += count;
+    return value;
+}
+
+const FibonacciCodeTables& fibonacci_code_tables() {
+    static const FibonacciCodeTables tables = []() {
+        FibonacciCodeTables t;
+        vector<BigInt> sequence = fibonacci_sequence(FIBONACCI_CODE_TERMS + 1);
+        for (int k = 2; k <= FIBONACCI_CODE_TERMS + 1; k++) {
+            const Limbs& limbs = sequence[k].limbs;
+            t.terms.push_back(limbs[0] | (limbs.size() > 1 ? static_cast<uint64_t>(limbs[1]) << 32 : 0));
+        }
+        
+        t.below_bits.assign(65, 0);
+        for (int b = 1; b <= 64; b++) {
+            int j = t.below_bits[b - 1];
+            while (j + 1 < FIBONACCI_CODE_TERMS && (b == 64 || t.terms[j + 1] >> b == 0)) j++;
+            t.below_bits[b] = j;
+        }
+        
+        // Sums wrap mod 2^64; only those of valid code words are used
+        t.byte_sums.resize((FIBONACCI_CODE_TERMS + 7) / 8);
+        for (size_t p = 0; p < t.byte_sums.size(); p++) {
+            for (int x = 0; x < 256; x++) {
+                uint64_t sum = 0;
+                for (int j = 0; j < 8 && 8 * p + j < t.terms.size(); j++) {
+                    if (x >> j & 1) sum += t.terms[8 * p + j];
+                }
+                t.byte_sums[p][x] = sum;
+            }
+        }
+        
+        for (uint64_t v = 0; v < FIBONACCI_SMALL_VALUES; v++) {
+            uint64_t rest = v + 1;
+            int top = FIBONACCI_CODE_TERMS - 1;
+            while (t.terms[top] > rest) top--;
+            uint32_t code = 1U << (top + 1);
+            for (int j = top; j >= 0; j--) {
+                if (t.terms[j] > rest) continue;
+                rest -= t.terms[j];
+                code |= 1U << j;
+            }
+            t.small_codes.push_back(code | static_cast<uint32_t>(top + 2) << 24);
+        }
+        return t;
+    }();
+    return tables;
+}
+
+// Largest j with F(j + 2) <= r, for r >= 1. Fewer than two terms lie in
+// [2^(b-1), 2^b), so the bit-length guess is at most two too high.
+static inline int fibonacci_floor_index(const FibonacciCodeTables& tables, uint64_t r) {
+    int j = tables.below_bits[64 - __builtin_clzll(r)];
+    j -= tables.terms[j] > r;
+    return j - (tables.terms[j] > r);
+}
+
+// Indices k of the terms F(k) summing to n, largest first; no two adjacent
+vector<int> zeckendorf(uint64_t n) {
+    const FibonacciCodeTables& tables = fibonacci_code_tables();
+    vector<int> parts;
+    while (n > 0) {
+        int j = fibonacci_floor_index(tables, n);
+        n -= tables.terms[j];
+        parts.push_back(j + 2);
+    }
+    return parts;
+}
+
+void fibonacci_encode(uint64_t value, BitWriter& out) {
+    const FibonacciCodeTables& tables = fibonacci_code_tables();
+    if (value < FIBONACCI_SMALL_VALUES) {
+        uint32_t code = tables.small_codes[value];
+        out.write(code & 0xffffff, code >> 24);
+        return;
+    }
+    
+    // Code word bits 0..63 and 64..92: greedy digits, then the terminator.
+    // value + 1 wraps to 0 only for 2^64 - 1, whose top digit is F(93).
+    uint64_t low = 0, high = 0, rest = value + 1;
+    int top;
+    if (rest == 0) {
+        top = FIBONACCI_CODE_TERMS - 1;
+        high |= 1ULL << (top - 64);
+        rest = value - tables.terms[top] + 1;
+    } else {
+        top = fibonacci_floor_index(tables, rest);
+    }
+    while (rest > 0) {
+        int j = fibonacci_floor_index(tables, rest);
+        rest -= tables.terms[j];
+        if (j < 64) low |= 1ULL << j;
+        else high |= 1ULL << (j - 64);
+    }
+    int length = top + 2;
+    if (length <= 64) low |= 1ULL << (length - 1);
+    else high |= 1ULL << (length - 65);
+    out.write(low, min(length, 64));
+    if (length > 64) out.write(high, length - 64);
+}
+
+// Reference decoder, one bit at a time. False on a truncated or malformed
+// code word.
+bool fibonacci_decode(BitReader& in, uint64_t& value) {
+    const vector<uint64_t>& fib = fibonacci_code_tables().terms;
+    unsigned __int128 sum = 0;
+    bool previous = false;
+    for (int j = 0; j <= FIBONACCI_CODE_TERMS && !in.done(); j++) {
+        bool bit = in.read(1) != 0;
+        if (bit && previous) {
+            if (sum > static_cast<unsigned __int128>(1) << 64) return false;
+            value = static_cast<uint64_t>(sum - 1);
+            return true;
+        }
+        if (bit && j == FIBONACCI_CODE_TERMS) return false;
+        if (bit) sum += fib[j];
+        previous = bit;
+    }
+    return false;
+}
+
+// Decodes 64 bits at a time. w & (w >> 1) marks every "11" in the window;
+// the lowest one at or after a code word's start is its end (the terminator
+// and the digit before it), and the digits are summed a byte at a time from
+// tables. A code word longer than the window takes its first 62 digits from
+// this window and the rest from the next. Returns the number of values
+// decoded; it stops early on a malformed stream.
+size_t fibonacci_decode_fast(BitReader& in, uint64_t* values, size_t count) {
+    const vector<array<uint64_t, 256>>& sums = fibonacci_code_tables().byte_sums;
+    const uint64_t LOW_62 = (1ULL << 62) - 1;
+    size_t decoded = 0;
+    while (decoded < count && !in.done()) {
+        uint64_t window = in.peek();
+        uint64_t ends = window & (window >> 1);
+        if (ends == 0) {
+            in.skip(62);
+            uint64_t next = in.peek();
+            uint64_t next_ends = next & (next >> 1);
+            int end = next_ends ? __builtin_ctzll(next_ends) : 64;
+            if (62 + end >= FIBONACCI_CODE_TERMS) break;
+            
+            // Digits 0..61 from window, 62..62 + end from next, summed mod 2^64
+            uint64_t rest = next & (~0ULL >> (63 - end));
+            uint64_t low = (window & LOW_62) | (rest << 62), high = rest >> 2;
+            uint64_t value = 0;
+            for (int p = 0; p < 8; p++) value += sums[p][(low >> (8 * p)) & 255];
+            for (int p = 8; high != 0; p++, high >>= 8) value += sums[p][high & 255];
+            values[decoded++] = value - 1;
+            in.skip(end + 2);
+            continue;
+        }
+        
+        int start = 0;
+        while (ends != 0 && decoded < count) {
+            int end = __builtin_ctzll(ends); // digits start..end, terminator at end + 1
+            uint64_t digits = (window >> start) & (~0ULL >> (63 - (end - start)));
+            uint64_t value = 0;
+            for (int p = 0; digits != 0; p++, digits >>= 8) value += sums[p][digits & 255];
+            values[decoded++] = value - 1;
+            start = end + 2;
+            ends = start < 64 ? ends & (~0ULL << start) : 0;
+        }
+        in.skip(start);
+    }
+    return decoded;
+}
+
+// LEB128: seven bits per byte, high bit set on every byte but the last
+void varint_encode(uint64_t value, vector<uint8_t>& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+size_t varint_decode(const vector<uint8_t>& in, uint64_t* values, size_t count) {
+    size_t pos = 0, decoded = 0;
+    while (decoded < count && pos < in.size()) {
+        uint64_t value = 0;
+        int shift = 0;
+        while (pos < in.size() && (in[pos] & 0x80) && shift < 63) {
+            value |= static_cast<uint64_t>(in[pos++] & 0x7f) << shift;
+            shift += 7;
+        }
+        if (pos == in.size()) break;
+        values[decoded++] = value | static_cast<uint64_t>(in[pos++]) << shift;
+    }
+    return decoded;
+}
+
+// Round-trips count values from each distribution through varint and
+// Fibonacci coding (bit-at-a-time and table decoders), printing the size in
+// bits per value and the throughput in millions of values per second
+int runCodecBenchmark(size_t count) {
+    const char* names[] = {"geometric, mean 8", "uniform below 2^16", "log-uniform below 2^32", "uniform 64-bit"};
+    mt19937_64 random(20240229);
+    geometric_distribution<long long> geometric(1.0 / 9);
+    bool ok = true;
+    
+    cout << left << setw(24) << "Distribution" << setw(20) << "Codec" << right << setw(12) << "bits/value"
+         << setw(13) << "encode M/s" << setw(13) << "decode M/s" << endl;
+    cout << string(82, '-') << endl;
+    for (int d = 0; d < 4; d++) {
+        vector<uint64_t> values(count), decoded(count);
+        for (size_t i = 0; i < count; i++) {
+            uint64_t r = random();
+            if (d == 0) values[i] = static_cast<uint64_t>(geometric(random));
+            else if (d == 1) values[i] = r & 0xffff;
+            else if (d == 2) values[i] = (r & 0xffffffffULL) >> (r >> 59);
+            else values[i] = r;
+        }
+        auto row = [&](const char* codec, size_t bits, double encode_s, double decode_s, bool match) {
+            cout << left << setw(24) << names[d] << setw(20) << codec << right << fixed << setprecision(2)
+                 << setw(12) << static_cast<double>(bits) / count << setprecision(1)
+                 << setw(13) << count / encode_s / 1e6 << setw(13) << count / decode_s / 1e6 << defaultfloat
+                 << (match ? "" : "  MISMATCH") << endl;
+            ok = ok && match;
+        };
+        
+        auto start = high_resolution_clock::now();
+        vector<uint8_t> bytes;
+        bytes.reserve(count * 2);
+        for (size_t i = 0; i < count; i++) varint_encode(values[i], bytes);
+        auto encoded = high_resolution_clock::now();
+        bool match = varint_decode(bytes, decoded.data(), count) == count && decoded == values;
+        auto finished = high_resolution_clock::now();
+        row("varint", bytes.size() * 8, duration<double>(encoded - start).count(),
+            duration<double>(finished - encoded).count(), match);
+        
+        start = high_resolution_clock::now();
+        BitWriter writer;
+        for (size_t i = 0; i < count; i++) fibonacci_encode(values[i], writer);
+        encoded = high_resolution_clock::now();
+        double encode_s = duration<double>(encoded - start).count();
+        
+        BitReader reader(writer.words(), writer.size());
+        fill(decoded.begin(), decoded.end(), 0);
+        match = true;
+        for (size_t i = 0; i < count && match; i++) match = fibonacci_decode(reader, decoded[i]);
+        match = match && decoded == values;
+        finished = high_resolution_clock::now();
+        row("Fibonacci, bitwise", writer.size(), encode_s, duration<double>(finished - encoded).count(), match);
+        
+        BitReader fast_reader(writer.words(), writer.size());
+        fill(decoded.begin(), decoded.end(), 0);
+        start = high_resolution_clock::now();
+        match = fibonacci_decode_fast(fast_reader, decoded.data(), count) == count && decoded == values;
+        finished = high_resolution_clock::now();
+        row("Fibonacci, table", writer.size(), encode_s, duration<double>(finished - start).count(), match);
+    }
+    return ok ? 0 : 1;
+}
+
+// ========== TOWER OF HANOI ==========
+void towerOfHanoi() {
+    clearScreen();
+    displayHeader("TOWER OF HANOI CALCULATOR");
+    
+    int n;
+    cout << "Enter number of disks (1-10 recommended): ";
+    cin >> n;
+    
+    if (n <= 0) {
+        cout << "Number of disks must be positive!" << endl;
+        pressEnterToContinue();
+        return;
+    }
+    
+    int choice;
+    cout << "\nChoose solution method:" << endl;
+    cout << "1. Recursive solution with steps" << endl;
+    cout << "2. Iterative solution" << endl;
+    cout << "3. Calculate minimum moves only" << endl;
+    cout << "4. Stream all moves without printing (count and time)" << endl;
+    cout << "5. Find the k-th move" << endl;
+    cout << "6. Show rod configuration after k moves" << endl;
+    cout << "7. Find the move number of a configuration" << endl;
+    cout << "8. Export all moves to a file (parallel, memory-mapped)" << endl;
+    cout << "9. Compare sequential and parallel recursion (speedup)" << endl;
+    cout << "10. Solve with 4 to 10 pegs (Frame-Stewart)" << endl;
+    cout << "11. Shortest solution from any configuration" << endl;
+    cout << "12. Validate a solution (generator or move file)" << endl;
+    cout << "Enter choice: ";
+    cin >> choice;
+    
+    cout << "\nMinimum moves required: " << hanoi_move_count_string(n) << endl;
+    
+    if ((choice == 2 || choice == 4 || choice == 8) && n > HanoiMoves::MAX_DISKS) {
+        cout << "The move generator supports at most " << HanoiMoves::MAX_DISKS << " disks!" << endl;
+        pressEnterToContinue();
+        return;
+    }
+    
+    switch(choice) {
+        case 1: {
+            cout << "\nRecursive solution steps:" << endl;
+            cout << string(50, '-') << endl;
+            int step = 0;
+            tower_of_hanoi_recursive(n, 'A', 'C', 'B', step);
+            cout << string(50, '-') << endl;
+            cout << "Total steps: " << step << endl;
+            break;
+        }
+        case 2: {
+            cout << "\nIterative solution steps:" << endl;
+            cout << string(50, '-') << endl;
+            tower_of_hanoi_iterative(n);
+            break;
+        }
+        case 3: {
+            cout << "\nMinimum moves calculation:" << endl;
+            cout << "Formula: 2^n - 1 = " << hanoi_move_count_string(n) << endl;
+            break;
+        }
+        case 4: {
+            streamHanoiMoves(n);
+            break;
+        }
+        case 5:
+        case 6:
+        case 7: {
+            hanoiRandomAccessQuery(n, choice);
+            break;
+        }
+        case 8: {
+            exportHanoiMenu(n);
+            break;
+        }
+        case 9: {
+            compareHanoiParallel(n);
+            break;
+        }
+        case 10: {
+            multiPegHanoi(n);
+            break;
+        }
+        case 11: {
+            solveConfigurationMenu(n);
+            break;
+        }
+        case 12: {
+            validateHanoiMenu(n);
+            break;
+        }
+        default:
+            cout << "Invalid choice!" << endl;
+    }
+    
+    pressEnterToContinue();
+}
+
+// Moves are written with '\n' rather than endl so the stream is flushed
+// once at the end instead of after every move.
+void tower_of_hanoi_recursive(int n, char from, char to, char aux, int& step) {
+    DM_PROBE(PROBE_HANOI_RECURSIVE);
+    if (n == 1) {
+        step++;
+        cout << "Step " << step << ": Move disk 1 from rod " 
+             << from << " to rod " << to << '\n';
+        return;
+    }
+    
+    tower_of_hanoi_recursive(n - 1, from, aux, to, step);
+    step++;
+    cout << "Step " << step << ": Move disk " << n 
+         << " from rod " << from << " to rod " << to << '\n';
+    tower_of_hanoi_recursive(n - 1, aux, to, from, step);
+}
+
+// Recursive solution written into out[0 .. 2^n - 2]: the n-1 tower's moves
+// fill the first half, the largest disk's move sits in the middle and the
+// second n-1 tower fills the rest, so the halves never overlap.
+void tower_of_hanoi_fill(int n, int from, int to, int aux, HanoiMove* out) {
+    if (n == 0) return;
+    size_t half = (size_t(1) << (n - 1)) - 1;
+    tower_of_hanoi_fill(n - 1, from, aux, to, out);
+    HanoiMove move = {n, from, to};
+    out[half] = move;
+    tower_of_hanoi_fill(n - 1, aux, to, from, out + half + 1);
+}
+
+void tower_of_hanoi_parallel(int n, int from, int to, int aux, HanoiMove* out, WorkStealingPool& pool, int cutoff) {
+    if (n <= cutoff) {
+        tower_of_hanoi_fill(n, from, to, aux, out);
+        return;
+    }
+    size_t half = (size_t(1) << (n - 1)) - 1;
+    TaskGroup group;
+    pool.spawn(group, [=, &pool]() { tower_of_hanoi_parallel(n - 1, from, aux, to, out, pool, cutoff); });
+    HanoiMove move = {n, from, to};
+    out[half] = move;
+    tower_of_hanoi_parallel(n - 1, aux, to, from, out + half + 1, pool, cutoff);
+    pool.wait(group);
+}
+
+void compareHanoiParallel(int n) {
+    const int MAX_DISKS = 24;
+    if (n > MAX_DISKS) {
+        cout << "The move list is kept in memory; use at most " << MAX_DISKS << " disks." << endl;
+        return;
+    }
+    int cutoff = min(parallel_cutoff(), n);
+    size_t moves = (size_t(1) << n) - 1;
+    vector<HanoiMove> expected(moves), result(moves);
+    
+    cout << "\nParallel recursive solution (work stealing, cutoff " << cutoff << "):" << endl;
+    auto start = high_resolution_clock::now();
+    tower_of_hanoi_fill(n, 0, 2, 1, expected.data());
+    double sequential = duration<double, milli>(high_resolution_clock::now() - start).count();
+    
+    cout << setw(8) << "Threads" << setw(14) << "Time (ms)" << setw(10) << "Speedup" << setw(10) << "Steals" << endl;
+    cout << setw(8) << "seq" << setw(14) << fixed << setprecision(2) << sequential << setw(10) << 1.0 << setw(10) << "-" << endl;
+    vector<unsigned> counts = scaling_thread_counts();
+    bool identical = true;
+    for (size_t i = 0; i < counts.size(); i++) {
+        WorkStealingPool pool(counts[i]);
+        start = high_resolution_clock::now();
+        tower_of_hanoi_parallel(n, 0, 2, 1, result.data(), pool, cutoff);
+        double elapsed = duration<double, milli>(high_resolution_clock::now() - start).count();
+        cout << setw(8) << counts[i] << setw(14) << elapsed << setw(10) << sequential / max(elapsed, 1e-6)
+             << setw(10) << pool.steals() << endl;
+        for (size_t k = 0; k < moves && identical; k++) {
+            identical = result[k].disk == expected[k].disk && result[k].from == expected[k].from && result[k].to == expected[k].to;
+        }
+    }
+    cout << defaultfloat;
+    cout << moves << " moves; parallel result " << (identical ? "matches" : "DIFFERS FROM") << " the sequential one." << endl;
+}
+
+void tower_of_hanoi_iterative(int n) {
+    HanoiMoves moves(n);
+    for (HanoiMoves::iterator it = moves.begin(); it != moves.end(); ++it) {
+        HanoiMove move = *it;
+        cout << "Step " << it.moveNumber() << ": Move disk " << move.disk
+             << " from rod " << static_cast<char>('A' + move.from)
+             << " to rod " << static_cast<char>('A' + move.to) << '\n';
+    }
+    cout << "Total steps: " << moves.total() << endl;
+}
+
+// Consumes the generator without any output, to show its raw speed
+void streamHanoiMoves(int n) {
+    vector<uint64_t> per_disk(n + 1, 0);
+    uint64_t count = 0;
+    
+    auto start = high_resolution_clock::now();
+    HanoiMoves moves(n);
+    HanoiMove move;
+    while (moves.next(move)) {
+        per_disk[move.disk]++;
+        count++;
+    }
+    double seconds = duration<double>(high_resolution_clock::now() - start).count();
+    
+    cout << "\nStreamed " << count << " moves in " << fixed << setprecision(3) << seconds << " s";
+    if (seconds > 0) cout << " (" << setprecision(1) << count / seconds / 1e6 << " million moves/s)";
+    cout << endl << defaultfloat;
+    for (int disk = 1; disk <= min(n, 5); disk++) {
+        cout << "Disk " << disk << " moved " << per_disk[disk] << " times" << endl;
+    }
+}
+
+void hanoiRandomAccessQuery(int n, int choice) {
+    if (n > HANOI_MAX_WIDE_DISKS) {
+        cout << "Random-access queries support at most " << HANOI_MAX_WIDE_DISKS << " disks!" << endl;
+        return;
+    }
+    
+    if (choice == 7) {
+        string rods;
+        cout << "Enter the rod (A, B or C) of each disk, smallest disk first: ";
+        cin >> rods;
+        if (static_cast<int>(rods.length()) != n) {
+            cout << "Expected exactly " << n << " rods!" << endl;
+            return;
+        }
+        
+        vector<int> config(n);
+        for (int i = 0; i < n; i++) {
+            char rod = static_cast<char>(toupper(rods[i]));
+            if (rod < 'A' || rod > 'C') {
+                cout << "Rods must be A, B or C!" << endl;
+                return;
+            }
+            config[i] = rod - 'A';
+        }
+        
+        MoveCount k;
+        if (hanoi_move_index(config, k)) {
+            cout << "This configuration is reached after move " << u128_to_string(k) << endl;
+        } else {
+            cout << "This configuration is not on the optimal path from A to C." << endl;
+        }
+        return;
+    }
+    
+    string text;
+    cout << "Enter k (0 to " << hanoi_move_count_string(n) << "): ";
+    cin >> text;
+    MoveCount k;
+    if (!parse_u128(text, k) || k > hanoi_move_count(n) || (choice == 5 && k == 0)) {
+        cout << "k is out of range!" << endl;
+        return;
+    }
+    
+    if (choice == 5) {
+        HanoiMove move = hanoi_kth_move(n, k);
+        cout << "Move " << u128_to_string(k) << ": Move disk " << move.disk
+             << " from rod " << static_cast<char>('A' + move.from)
+             << " to rod " << static_cast<char>('A' + move.to) << endl;
+    } else {
+        vector<int> config = hanoi_configuration(n, k);
+        vector<stack<int>> rods(3);
+        for (int disk = n; disk >= 1; disk--) rods[config[disk - 1]].push(disk);
+        cout << "Configuration after " << u128_to_string(k) << " moves:" << endl;
+        display_towers(n, rods);
+    }
+}
+
+// Prints each rod's disks from bottom to top
+void display_towers(int n, const vector<stack<int>>& rods) {
+    for (size_t r = 0; r < rods.size(); r++) {
+        stack<int> rod = rods[r];
+        vector<int> disks;
+        while (!rod.empty()) {
+            disks.push_back(rod.top());
+            rod.pop();
+        }
+        cout << "Rod " << static_cast<char>('A' + r) << ": ";
+        if (disks.empty()) cout << "(empty)";
+        for (size_t i = disks.size(); i-- > 0;) {
+            cout << setw(to_string(n).length()) << disks[i] << (i > 0 ? " " : "");
+        }
+        cout << endl;
+    }
+}
+
+MoveCount hanoi_move_count(int n) {
+    return (static_cast<MoveCount>(1) << n) - 1;
+}
+
+// Exact 2^n - 1, in 128 bits when it fits; past HANOI_MAX_EXACT_DISKS the
+// decimal expansion would run to tens of thousands of digits, so the count
+// is given in scientific notation from n log10(2) instead.
+string hanoi_move_count_string(int n) {
+    if (n <= HANOI_MAX_WIDE_DISKS) return u128_to_string(hanoi_move_count(n));
+    if (n > HANOI_MAX_EXACT_DISKS) {
+        long double exponent = n * log10l(2.0L);
+        long double whole = floorl(exponent);
+        ostringstream text;
+        text << fixed << setprecision(5) << powl(10.0L, exponent - whole) << "e+" << static_cast<long long>(whole)
+             << " (approximately)";
+        return text.str();
+    }
+    BigInt count;
+    count.limbs.assign(n / 32, 0xFFFFFFFFu);
+    if (n % 32) count.limbs.push_back((1u << (n % 32)) - 1);
+    return count.toString();
+}
+
+// Same bit-pattern rule as HanoiMoves, in 128-bit arithmetic
+HanoiMove hanoi_kth_move(int n, MoveCount k) {
+    static const int SWAPPED[3] = {0, 2, 1};
+    HanoiMove move;
+    uint64_t low = static_cast<uint64_t>(k);
+    move.disk = low ? __builtin_ctzll(low) + 1 : __builtin_ctzll(static_cast<uint64_t>(k >> 64)) + 65;
+    move.from = static_cast<int>((k & (k - 1)) % 3);
+    move.to = static_cast<int>(((k | (k - 1)) + 1) % 3);
+    if (n % 2 == 0) {
+        move.from = SWAPPED[move.from];
+        move.to = SWAPPED[move.to];
+    }
+    return move;
+}
+
+// Walks from the largest disk down. Moving disk d's tower from src to dst
+// takes 2^d - 1 moves, and disk d itself moves at move 2^(d-1); before that
+// the smaller tower is heading src -> aux, after it aux -> dst.
+// Returns the rod of each disk, smallest first.
+vector<int> hanoi_configuration(int n, MoveCount k) {
+    vector<int> config(n);
+    int src = 0, dst = 2, aux = 1;
+    for (int disk = n; disk >= 1; disk--) {
+        MoveCount half = static_cast<MoveCount>(1) << (disk - 1);
+        if (k < half) {
+            config[disk - 1] = src;
+            swap(dst, aux);
+        } else {
+            config[disk - 1] = dst;
+            k -= half;
+            swap(src, aux);
+        }
+    }
+    return config;
+}
+
+// Inverse of hanoi_configuration: a disk on src contributes a 0 bit, on dst
+// a 1 bit, and a disk on aux means the configuration is off the optimal path.
+bool hanoi_move_index(const vector<int>& config, MoveCount& k) {
+    int n = static_cast<int>(config.size());
+    if (n > HANOI_MAX_WIDE_DISKS) return false;
+    
+    k = 0;
+    int src = 0, dst = 2, aux = 1;
+    for (int disk = n; disk >= 1; disk--) {
+        if (config[disk - 1] == src) {
+            swap(dst, aux);
+        } else if (config[disk - 1] == dst) {
+            k += static_cast<MoveCount>(1) << (disk - 1);
+            swap(src, aux);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parse_u128(const string& text, MoveCount& value) {
+    if (text.empty() || text.length() > 39) return false;
+    value = 0;
+    for (size_t i = 0; i < text.length(); i++) {
+        if (!isdigit(static_cast<unsigned char>(text[i]))) return false;
+        unsigned digit = text[i] - '0';
+        if (value > (~static_cast<MoveCount>(0) - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+void exportHanoiMenu(int n) {
+    int format;
+    cout << "Record format (1=text \"DD F T\", 2=packed binary): ";
+    cin >> format;
+    string path;
+    cout << "Output file: ";
+    cin >> path;
+    
+    bool binary = (format == 2);
+    uint64_t moves = hanoi_move_count(n);
+    double gigabytes = static_cast<double>(moves) * (binary ? HANOI_BINARY_RECORD : HANOI_TEXT_RECORD) / 1e9;
+    if (gigabytes > 1) {
+        cout << "Warning: the file will be " << fixed << setprecision(1) << gigabytes << " GB!" << endl << defaultfloat;
+        cout << "Continue anyway? (1=Yes, 0=No): ";
+        int continue_choice;
+        cin >> continue_choice;
+        if (!continue_choice) return;
+    }
+    
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    string error;
+    auto start = high_resolution_clock::now();
+    if (!export_hanoi_moves(n, path, binary, threads, error)) {
+        cout << "Export failed: " << error << endl;
+        return;
+    }
+    double seconds = duration<double>(high_resolution_clock::now() - start).count();
+    cout << "Wrote " << moves << " moves to " << path << " using " << threads << " threads in "
+         << fixed << setprecision(3) << seconds << " s" << endl << defaultfloat;
+}
+
+// The move range is cut into many more chunks than threads; each worker
+// claims the next chunk from an atomic counter and writes its records
+// straight into the mapped file. Records are fixed-size, so a chunk's
+// position in the file follows from its first move number, and the
+// generator starts directly at that move.
+bool export_hanoi_moves(int n, const string& path, bool binary, unsigned threads, string& error) {
+#ifdef _WIN32
+    (void)n; (void)path; (void)binary; (void)threads;
+    error = "memory-mapped export is not available on Windows";
+    return false;
+#else
+    const uint64_t CHUNK_MOVES = 1 << 20;
+    uint64_t moves = hanoi_move_count(n);
+    size_t record = binary ? HANOI_BINARY_RECORD : HANOI_TEXT_RECORD;
+    size_t header = binary ? HANOI_BINARY_HEADER : 0;
+    
+    // Text records for n >= 62 overflow 64 bits; check before sizing the file
+    uint64_t limit = min<uint64_t>(numeric_limits<size_t>::max(), numeric_limits<off_t>::max());
+    if (moves > (limit - header) / record) {
+        error = "the " + to_string(n) + "-disk solution (" + hanoi_move_count_string(n)
+              + " moves) is too large for one file";
+        return false;
+    }
+    size_t size = header + moves * record;
+    string directory = path.find('/') == string::npos ? "." : path.substr(0, path.rfind('/') + 1);
+    struct statvfs disk;
+    if (statvfs(directory.c_str(), &disk) == 0 && disk.f_frsize > 0 && size / disk.f_frsize >= disk.f_bavail) {
+        error = "the " + to_string(n) + "-disk solution needs " + to_string(size) + " bytes, more than is free in "
+              + directory;
+        return false;
+    }
+    
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        error = "cannot resize " + path;
+        return false;
+    }
+    char* data = static_cast<char*>(mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    if (data == MAP_FAILED) {
+        close(fd);
+        error = "cannot map " + path;
+        return false;
+    }
+    
+    if (binary) {
+        // Header: magic, disk count, record size
+        memset(data, 0, header);
+        memcpy(data, "DMHANOI1", 8);
+        uint32_t fields[2] = {static_cast<uint32_t>(n), static_cast<uint32_t>(record)};
+        memcpy(data + 8, fields, sizeof(fields));
+    }
+    
+    uint64_t chunks = (moves + CHUNK_MOVES - 1) / CHUNK_MOVES;
+    atomic<uint64_t> next_chunk(0);
+    vector<thread> workers;
+    for (unsigned t = 0; t < max(1u, threads); t++) {
+        workers.push_back(thread([&]() {
+            for (uint64_t chunk = next_chunk++; chunk < chunks; chunk = next_chunk++) {
+                uint64_t first = chunk * CHUNK_MOVES + 1;
+                uint64_t last = min(moves, first + CHUNK_MOVES - 1);
+                write_hanoi_chunk(n, first, last, binary, data + header + (first - 1) * record);
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+    
+    munmap(data, size);
+    close(fd);
+    return true;
+#endif
+}
+
+void write_hanoi_chunk(int n, uint64_t first, uint64_t last, bool binary, char* out) {
+    HanoiMoves moves(n, first, last);
+    HanoiMove move;
+    if (binary) {
+        while (moves.next(move)) {
+            *out++ = static_cast<char>(move.disk);
+            *out++ = static_cast<char>(move.from << 4 | move.to);
+        }
+        return;
+    }
+    while (moves.next(move)) {
+        out[0] = static_cast<char>('0' + move.disk / 10);
+        out[1] = static_cast<char>('0' + move.disk % 10);
+        out[2] = ' ';
+        out[3] = static_cast<char>('A' + move.from);
+        out[4] = ' ';
+        out[5] = static_cast<char>('A' + move.to);
+        out[6] = '\n';
+        out += HANOI_TEXT_RECORD;
+    }
+}
+
+HanoiMoves::HanoiMoves(int disks)
+    : first_move(1), last_move((uint64_t(1) << disks) - 1), cursor(1), swap_pegs(disks % 2 == 0) {}
+
+HanoiMoves::HanoiMoves(int disks, uint64_t first, uint64_t last)
+    : first_move(first), last_move(last), cursor(first), swap_pegs(disks % 2 == 0) {}
+
+bool HanoiMoves::next(HanoiMove& move) {
+    if (cursor > last_move) return false;
+    move = *iterator(cursor++, swap_pegs);
+    return true;
+}
+
+HanoiMove HanoiMoves::iterator::operator*() const {
+    static const int SWAPPED[3] = {0, 2, 1};
+    HanoiMove move;
+    move.disk = __builtin_ctzll(k) + 1;
+    move.from = static_cast<int>((k & (k - 1)) % 3);
+    move.to = static_cast<int>(((k | (k - 1)) + 1) % 3);
+    if (swap_pegs) {
+        move.from = SWAPPED[move.from];
+        move.to = SWAPPED[move.to];
+    }
+    return move;
+}
+
+// ========== MULTI-PEG HANOI ==========
+shared_ptr<const FrameStewartTable> frame_stewart_cache;
+mutex frame_stewart_mutex;
+
+MoveCount saturating_add(MoveCount a, MoveCount b) {
+    return a + b < a ? ~MoveCount(0) : a + b;
+}
+
+void multiPegHanoi(int n) {
+    if (n > MULTIPEG_MAX_DISKS) {
+        cout << "The multi-peg solver supports at most " << MULTIPEG_MAX_DISKS << " disks!" << endl;
+        return;
+    }
+    int pegs;
+    cout << "Enter number of pegs (4-" << MULTIPEG_MAX_PEGS << "): ";
+    cin >> pegs;
+    if (pegs < 4 || pegs > MULTIPEG_MAX_PEGS) {
+        cout << "Number of pegs must be between 4 and " << MULTIPEG_MAX_PEGS << "!" << endl;
+        return;
+    }
+    
+    auto start = high_resolution_clock::now();
+    shared_ptr<const FrameStewartTable> table = frame_stewart_table(n, pegs);
+    double build = duration<double, milli>(high_resolution_clock::now() - start).count();
+    
+    cout << "\nFrame-Stewart move counts for " << n << " disks:" << endl;
+    for (int p = 3; p <= pegs; p++) {
+        MoveCount moves = table->moves[table->index(n, p)];
+        cout << "  " << setw(2) << p << " pegs: "
+             << (moves == ~MoveCount(0) ? string("more than 2^128") : u128_to_string(moves))
+             << "  (park " << table->split[table->index(n, p)] << " disks first)" << endl;
+    }
+    cout << "Table " << table->max_disks << " disks x " << table->max_pegs << " pegs ready in "
+         << fixed << setprecision(2) << build << " ms" << endl << defaultfloat;
+    
+    MultiPegMoves moves(n, pegs);
+    const MoveCount PRINT_LIMIT = 1000;
+    if (moves.total() <= PRINT_LIMIT) {
+        cout << "\nMoves (pegs A-" << static_cast<char>('A' + pegs - 1) << "):" << endl;
+        cout << string(50, '-') << endl;
+        int step = 0;
+        for (HanoiMove move : moves) {
+            cout << "Step " << ++step << ": Move disk " << move.disk << " from rod "
+                 << static_cast<char>('A' + move.from) << " to rod " << static_cast<char>('A' + move.to) << '\n';
+        }
+        cout << string(50, '-') << endl;
+        return;
+    }
+    
+    cout << "\nMore than " << u128_to_string(PRINT_LIMIT) << " moves; streaming without printing..." << endl;
+    uint64_t count = 0;
+    HanoiMove move;
+    start = high_resolution_clock::now();
+    while (moves.next(move)) count++;
+    double seconds = duration<double>(high_resolution_clock::now() - start).count();
+    cout << "Streamed " << count << " moves in " << fixed << setprecision(3) << seconds << " s" << endl << defaultfloat;
+}
+
+// Returns a table covering at least disks x pegs. A larger table replaces the
+// cached one (readers keep theirs through the shared_ptr); it is grown to at
+// least double the previous disk count so repeated queries rebuild rarely.
+shared_ptr<const FrameStewartTable> frame_stewart_table(int disks, int pegs) {
+    lock_guard<mutex> guard(frame_stewart_mutex);
+    if (frame_stewart_cache && frame_stewart_cache->max_disks >= disks && frame_stewart_cache->max_pegs >= pegs) {
+        return frame_stewart_cache;
+    }
+    
+    shared_ptr<FrameStewartTable> table(new FrameStewartTable());
+    table->max_disks = max(disks, 64);
+    table->max_pegs = max(pegs, 4);
+    if (frame_stewart_cache) {
+        table->max_disks = max(table->max_disks, min(2 * frame_stewart_cache->max_disks, MULTIPEG_MAX_DISKS));
+        table->max_pegs = max(table->max_pegs, frame_stewart_cache->max_pegs);
+    }
+    WorkStealingPool pool(thread::hardware_concurrency());
+    build_frame_stewart(*table, pool);
+    frame_stewart_cache = table;
+    return table;
+}
+
+// Cell (n, p) needs (k, p) for k < n and (n - k, p - 1), both on earlier
+// anti-diagonals n + p, so every cell of one diagonal is independent. The
+// diagonals are swept in order and the cells of each run on the pool.
+void build_frame_stewart(FrameStewartTable& table, WorkStealingPool& pool) {
+    int rows = table.max_disks + 1, cols = table.max_pegs + 1;
+    table.moves.assign(static_cast<size_t>(rows) * cols, 0);
+    table.split.assign(static_cast<size_t>(rows) * cols, 0);
+    
+    // Three pegs: 2^n - 1, parking n - 1 disks
+    MoveCount three = 0;
+    for (int n = 1; n <= table.max_disks; n++) {
+        three = saturating_add(saturating_add(three, three), 1);
+        table.moves[table.index(n, 3)] = three;
+        table.split[table.index(n, 3)] = n - 1;
+    }
+    for (int p = 4; p <= table.max_pegs; p++) table.moves[table.index(1, p)] = 1;
+    
+    for (int diagonal = 2 + 4; diagonal <= table.max_disks + table.max_pegs; diagonal++) {
+        TaskGroup group;
+        int first = max(4, diagonal - table.max_disks), last = min(table.max_pegs, diagonal - 2);
+        for (int p = first; p < last; p++) {
+            pool.spawn(group, [&table, diagonal, p]() { frame_stewart_cell(table, diagonal - p, p); });
+        }
+        if (first <= last) frame_stewart_cell(table, diagonal - last, last);
+        pool.wait(group);
+    }
+}
+
+void frame_stewart_cell(FrameStewartTable& table, int n, int p) {
+    MoveCount best = ~MoveCount(0);
+    int best_split = 1;
+    for (int k = 1; k < n; k++) {
+        MoveCount parked = table.moves[table.index(k, p)];
+        MoveCount cost = saturating_add(saturating_add(parked, parked), table.moves[table.index(n - k, p - 1)]);
+        if (cost < best) {
+            best = cost;
+            best_split = k;
+        }
+    }
+    table.moves[table.index(n, p)] = best;
+    table.split[table.index(n, p)] = best_split;
+}
+
+MoveCount frame_stewart_moves(int disks, int pegs) {
+    shared_ptr<const FrameStewartTable> table = frame_stewart_table(disks, pegs);
+    return table->moves[table->index(disks, pegs)];
+}
+
+MultiPegMoves::MultiPegMoves(int disks, int pegs) : table(frame_stewart_table(disks, pegs)) {
+    total_moves = table->moves[table->index(disks, pegs)];
+    Frame root = {disks, 0, 0, pegs - 1, -1, (1u << pegs) - 1, 0};
+    frames.push_back(root);
+}
+
+// Stage 0 parks the top split disks on the lowest free peg, stage 1 moves
+// the rest without that peg, and stage 2 turns the frame into the move that
+// brings the parked disks back.
+bool MultiPegMoves::next(HanoiMove& move) {
+    while (!frames.empty()) {
+        Frame frame = frames.back();
+        if (frame.disks == 1) {
+            move.disk = frame.base + 1;
+            move.from = frame.from;
+            move.to = frame.to;
+            frames.pop_back();
+            return true;
+        }
+        int pegs = __builtin_popcount(frame.usable);
+        int split = table->split[table->index(frame.disks, pegs)];
+        if (frame.stage == 0) {
+            unsigned spare = frame.usable & ~(1u << frame.from) & ~(1u << frame.to);
+            frames.back().via = __builtin_ctz(spare);
+            frames.back().stage = 1;
+            Frame park = {split, frame.base, frame.from, frames.back().via, -1, frame.usable, 0};
+            frames.push_back(park);
+        } else if (frame.stage == 1) {
+            frames.back().stage = 2;
+            Frame rest = {frame.disks - split, frame.base + split, frame.from, frame.to, -1,
+                          frame.usable & ~(1u << frame.via), 0};
+            frames.push_back(rest);
+        } else {
+            Frame unpark = {split, frame.base, frame.via, frame.to, -1, frame.usable, 0};
+            frames.back() = unpark;
+        }
+    }
+    return false;
+}
+
+// ========== CONFIGURATION SOLVER ==========
+void solveConfigurationMenu(int n) {
+    int pegs;
+    cout << "Enter number of pegs (3 or 4): ";
+    cin >> pegs;
+    if (pegs != 3 && pegs != 4) {
+        cout << "Arbitrary configurations are supported on 3 or 4 pegs!" << endl;
+        return;
+    }
+    if (n > (pegs == 3 ? HANOI_MAX_WIDE_DISKS : HANOI_SEARCH_MAX_DISKS)) {
+        cout << "At most " << (pegs == 3 ? HANOI_MAX_WIDE_DISKS : HANOI_SEARCH_MAX_DISKS)
+             << " disks are supported with " << pegs << " pegs!" << endl;
+        return;
+    }
+    
+    char last = static_cast<char>('A' + pegs - 1);
+    string rods;
+    vector<int> start, goal;
+    cout << "Enter the rod (A-" << last << ") of each disk, smallest disk first: ";
+    cin >> rods;
+    if (!read_configuration(n, pegs, rods, start)) return;
+    cout << "Enter the target rods the same way (or - for every disk on rod " << last << "): ";
+    cin >> rods;
+    if (rods == "-") goal.assign(n, pegs - 1);
+    else if (!read_configuration(n, pegs, rods, goal)) return;
+    
+    vector<HanoiMove> moves;
+    auto begin = high_resolution_clock::now();
+    if (pegs == 3) {
+        bool twice;
+        MoveCount distance = hanoi_distance(start, goal, twice);
+        cout << "\nMinimum moves: " << u128_to_string(distance)
+             << (twice ? " (largest differing disk moves twice)" : "") << endl;
+        if (distance > 1000) {
+            cout << "Too many moves to list." << endl;
+            return;
+        }
+        moves = hanoi_solve(start, goal);
+    } else {
+        if (!hanoi_search(start, goal, pegs, moves)) {
+            cout << "No solution found." << endl;
+            return;
+        }
+        cout << "\nMinimum moves: " << moves.size() << endl;
+    }
+    double elapsed = duration<double, milli>(high_resolution_clock::now() - begin).count();
+    
+    cout << string(50, '-') << endl;
+    for (size_t i = 0; i < moves.size(); i++) {
+        cout << "Step " << i + 1 << ": Move disk " << moves[i].disk << " from rod "
+             << static_cast<char>('A' + moves[i].from) << " to rod " << static_cast<char>('A' + moves[i].to) << '\n';
+    }
+    cout << string(50, '-') << endl;
+    cout << "Solved in " << fixed << setprecision(2) << elapsed << " ms" << endl << defaultfloat;
+}
+
+bool read_configuration(int n, int pegs, const string& rods, vector<int>& config) {
+    if (static_cast<int>(rods.length()) != n) {
+        cout << "Expected exactly " << n << " rods!" << endl;
+        return false;
+    }
+    config.assign(n, 0);
+    for (int i = 0; i < n; i++) {
+        int rod = toupper(rods[i]) - 'A';
+        if (rod < 0 || rod >= pegs) {
+            cout << "Rods must be between A and " << static_cast<char>('A' + pegs - 1) << "!" << endl;
+            return false;
+        }
+        config[i] = rod;
+    }
+    return true;
+}
+
+// Moves needed to gather disks 1..m of config onto target: disk m either is
+// there already, or the smaller disks gather on the third peg, m moves, and
+// the (now perfect) tower of m - 1 disks follows it.
+MoveCount hanoi_gather_count(const vector<int>& config, int m, int target) {
+    MoveCount moves = 0;
+    for (; m >= 1; m--) {
+        if (config[m - 1] == target) continue;
+        moves += static_cast<MoveCount>(1) << (m - 1);
+        target = 3 - config[m - 1] - target;
+    }
+    return moves;
+}
+
+void hanoi_gather(const vector<int>& config, int m, int target, vector<HanoiMove>& out) {
+    if (m == 0) return;
+    if (config[m - 1] == target) {
+        hanoi_gather(config, m - 1, target, out);
+        return;
+    }
+    int spare = 3 - config[m - 1] - target;
+    hanoi_gather(config, m - 1, spare, out);
+    HanoiMove move = {m, config[m - 1], target};
+    out.push_back(move);
+    hanoi_tower(m - 1, spare, target, out);
+}
+
+void hanoi_tower(int m, int from, int to, vector<HanoiMove>& out) {
+    if (m == 0) return;
+    int pegs[3] = {from, 3 - from - to, to}; // generator pegs A, B, C
+    HanoiMoves moves(m);
+    HanoiMove move;
+    while (moves.next(move)) {
+        move.from = pegs[move.from];
+        move.to = pegs[move.to];
+        out.push_back(move);
+    }
+}
+
+// Disks larger than the largest differing disk k never move. k goes from a
+// to b either once (smaller disks gather on the third peg c, then spread to
+// the goal) or twice via c (smaller disks gather on b, k moves to c, the
+// tower goes back to a, k moves to b). The second can win when the smaller
+// disks already sit mostly on b and end up mostly on a.
+MoveCount hanoi_distance(const vector<int>& start, const vector<int>& goal, bool& twice) {
+    int k = static_cast<int>(start.size());
+    while (k > 0 && start[k - 1] == goal[k - 1]) k--;
+    twice = false;
+    if (k == 0) return 0;
+    
+    int a = start[k - 1], b = goal[k - 1], c = 3 - a - b;
+    MoveCount once = hanoi_gather_count(start, k - 1, c) + 1 + hanoi_gather_count(goal, k - 1, c);
+    MoveCount via = hanoi_gather_count(start, k - 1, b) + 2 + hanoi_move_count(k - 1) + hanoi_gather_count(goal, k - 1, a);
+    twice = via < once;
+    return twice ? via : once;
+}
+
+vector<HanoiMove> hanoi_solve(const vector<int>& start, const vector<int>& goal) {
+    vector<HanoiMove> moves, tail;
+    bool twice;
+    if (hanoi_distance(start, goal, twice) == 0) return moves;
+    int k = static_cast<int>(start.size());
+    while (start[k - 1] == goal[k - 1]) k--;
+    
+    int a = start[k - 1], b = goal[k - 1], c = 3 - a - b;
+    int rest; // peg holding disks 1..k-1 just before they spread to the goal
+    if (twice) {
+        hanoi_gather(start, k - 1, b, moves);
+        HanoiMove out = {k, a, c};
+        moves.push_back(out);
+        hanoi_tower(k - 1, b, a, moves);
+        HanoiMove in = {k, c, b};
+        moves.push_back(in);
+        rest = a;
+    } else {
+        hanoi_gather(start, k - 1, c, moves);
+        HanoiMove move = {k, a, b};
+        moves.push_back(move);
+        rest = c;
+    }
+    
+    // Spreading onto the goal is gathering from the goal, played backwards
+    hanoi_gather(goal, k - 1, rest, tail);
+    for (size_t i = tail.size(); i-- > 0;) {
+        HanoiMove move = {tail[i].disk, tail[i].to, tail[i].from};
+        moves.push_back(move);
+    }
+    return moves;
+}
+
+// Breadth-first search from both ends over states packed 2 bits per disk.
+// The smaller frontier expands one full level at a time; the best meeting
+// found in that level gives the shortest path. A state first reached from
+// the other side is at its current depth or one less, which its distance
+// mod 3 tells apart.
+bool hanoi_search(const vector<int>& start, const vector<int>& goal, int pegs, vector<HanoiMove>& path) {
+    int n = static_cast<int>(start.size());
+    uint32_t roots[2] = {0, 0};
+    for (int i = 0; i < n; i++) {
+        roots[0] |= static_cast<uint32_t>(start[i]) << (2 * i);
+        roots[1] |= static_cast<uint32_t>(goal[i]) << (2 * i);
+    }
+    path.clear();
+    if (roots[0] == roots[1]) return true;
+    
+    DistanceTable seen[2] = {DistanceTable(n), DistanceTable(n)};
+    vector<uint32_t> frontier[2], next, neighbours;
+    int depth[2] = {0, 0};
+    for (int side = 0; side < 2; side++) {
+        seen[side].set(roots[side], 0);
+        frontier[side].push_back(roots[side]);
+    }
+    
+    bool found = false;
+    int best = 0;
+    uint32_t meeting = 0;
+    while (!found && !frontier[0].empty() && !frontier[1].empty()) {
+        int side = frontier[0].size() <= frontier[1].size() ? 0 : 1, other = 1 - side;
+        next.clear();
+        for (size_t i = 0; i < frontier[side].size(); i++) {
+            hanoi_neighbours(frontier[side][i], n, pegs, neighbours);
+            for (size_t j = 0; j < neighbours.size(); j++) {
+                uint32_t state = neighbours[j];
+                int mark = seen[other].get(state);
+                if (mark) {
+                    int far = mark == depth[other] % 3 + 1 ? depth[other] : depth[other] - 1;
+                    if (!found || depth[side] + 1 + far < best) {
+                        best = depth[side] + 1 + far;
+                        meeting = state;
+                    }
+                    found = true;
+                }
+                if (!seen[side].get(state)) {
+                    seen[side].set(state, depth[side] + 1);
+                    next.push_back(state);
+                }
+            }
+        }
+        depth[side]++;
+        frontier[side].swap(next);
+    }
+    if (!found) return false;
+    
+    vector<uint32_t> states = hanoi_walk_back(seen[0], meeting, roots[0], n, pegs);
+    reverse(states.begin(), states.end());
+    vector<uint32_t> rest = hanoi_walk_back(seen[1], meeting, roots[1], n, pegs);
+    states.insert(states.end(), rest.begin() + 1, rest.end());
+    
+    for (size_t i = 1; i < states.size(); i++) {
+        uint32_t changed = states[i - 1] ^ states[i];
+        int disk = __builtin_ctz(changed) / 2;
+        HanoiMove move = {disk + 1, static_cast<int>((states[i - 1] >> (2 * disk)) & 3),
+                          static_cast<int>((states[i] >> (2 * disk)) & 3)};
+        path.push_back(move);
+    }
+    return true;
+}
+
+// Legal successors: the smallest disk on a peg may go to any peg whose top
+// disk is larger, or which is empty.
+void hanoi_neighbours(uint32_t state, int n, int pegs, vector<uint32_t>& out) {
+    out.clear();
+    int top[4] = {-1, -1, -1, -1};
+    for (int disk = 0; disk < n; disk++) {
+        int peg = (state >> (2 * disk)) & 3;
+        if (top[peg] < 0) top[peg] = disk;
+    }
+    for (int from = 0; from < pegs; from++) {
+        if (top[from] < 0) continue;
+        for (int to = 0; to < pegs; to++) {
+            if (to == from || (top[to] >= 0 && top[to] < top[from])) continue;
+            int shift = 2 * top[from];
+            out.push_back((state & ~(3u << shift)) | (static_cast<uint32_t>(to) << shift));
+        }
+    }
+}
+
+// States from state back to root, each one step closer (distance mod 3 drops by one)
+vector<uint32_t> hanoi_walk_back(const DistanceTable& table, uint32_t state, uint32_t root, int n, int pegs) {
+    vector<uint32_t> states(1, state), neighbours;
+    while (state != root) {
+        int previous = (table.get(state) + 1) % 3 + 1; // (d - 1) mod 3, encoded
+        hanoi_neighbours(state, n, pegs, neighbours);
+        for (size_t i = 0; i < neighbours.size(); i++) {
+            if (table.get(neighbours[i]) == previous) {
+                state = neighbours[i];
+                break;
+            }
+        }
+        states.push_back(state);
+    }
+    return states;
+}
+
+// ========== SOLUTION VALIDATOR ==========
+void validateHanoiMenu(int n) {
+    cout << "\nWhat should be validated?" << endl;
+    cout << "1. The 3-peg move generator" << endl;
+    cout << "2. The Frame-Stewart generator (4-" << MULTIPEG_MAX_PEGS << " pegs)" << endl;
+    cout << "3. A move file (text or binary export)" << endl;
+    cout << "Enter choice: ";
+    int choice;
+    cin >> choice;
+    
+    int pegs = 3;
+    HanoiMove bad = {0, 0, 0};
+    bool legal = true;
+    uint64_t applied = 0;
+    auto start = high_resolution_clock::now();
+    if (choice == 1) {
+        if (n > HanoiMoves::MAX_DISKS) {
+            cout << "The move generator supports at most " << HanoiMoves::MAX_DISKS << " disks!" << endl;
+            return;
+        }
+        PegSimulator sim(n, 3);
+        HanoiMoves moves(n);
+        start = high_resolution_clock::now();
+        applied = validate_moves(sim, moves, bad, legal);
+        printValidation(sim, applied, legal, bad, 2, duration<double>(high_resolution_clock::now() - start).count());
+    } else if (choice == 2) {
+        cout << "Enter number of pegs (4-" << MULTIPEG_MAX_PEGS << "): ";
+        cin >> pegs;
+        if (pegs < 4 || pegs > MULTIPEG_MAX_PEGS || n > MULTIPEG_MAX_DISKS) {
+            cout << "Pegs must be 4-" << MULTIPEG_MAX_PEGS << " and disks at most " << MULTIPEG_MAX_DISKS << "!" << endl;
+            return;
+        }
+        PegSimulator sim(n, pegs);
+        MultiPegMoves moves(n, pegs);
+        start = high_resolution_clock::now();
+        applied = validate_moves(sim, moves, bad, legal);
+        printValidation(sim, applied, legal, bad, pegs - 1, duration<double>(high_resolution_clock::now() - start).count());
+    } else if (choice == 3) {
+        string path;
+        cout << "Move file: ";
+        cin >> path;
+        cout << "Number of pegs (3-16): ";
+        cin >> pegs;
+        runValidation(path.c_str(), n, pegs);
+    } else {
+        cout << "Invalid choice!" << endl;
+    }
+}
+
+// Applies moves until the source ends or a move is illegal; returns how many
+// were applied. bad holds the refused move.
+template <class Source>
+uint64_t validate_moves(PegSimulator& sim, Source& source, HanoiMove& bad, bool& legal) {
+    uint64_t applied = 0;
+    HanoiMove move;
+    legal = true;
+    while (source.next(move)) {
+        if (!sim.apply(move)) {
+            bad = move;
+            legal = false;
+            break;
+        }
+        applied++;
+    }
+    return applied;
+}
+
+void printValidation(const PegSimulator& sim, uint64_t applied, bool legal, const HanoiMove& bad,
+                     int target, double seconds) {
+    cout << "\nChecked " << applied << " moves in " << fixed << setprecision(3) << seconds << " s";
+    if (seconds > 0) cout << " (" << setprecision(1) << applied / seconds / 1e6 << " million moves/s)";
+    cout << endl << defaultfloat;
+    if (!legal) {
+        cerr << "Move " << applied + 1 << " is illegal: disk " << bad.disk << " from rod "
+             << static_cast<char>('A' + bad.from) << " to rod " << static_cast<char>('A' + bad.to) << endl;
+        cerr << "Reason: " << sim.explain(bad) << endl;
+    } else if (sim.solved(target)) {
+        cout << "Every move is legal and all disks end on rod " << static_cast<char>('A' + target) << "." << endl;
+    } else {
+        cerr << "Every move is legal, but the tower is not complete on rod " << static_cast<char>('A' + target) << "." << endl;
+    }
+}
+
+// Shared by the menu and --validate-hanoi. The target rod is C for three
+// pegs and the last rod otherwise, matching the generators.
+int runValidation(const char* path, int disks, int pegs) {
+    MoveFileReader reader;
+    string error;
+    if (!reader.open(path, error)) {
+        cerr << "Error: " << error << endl;
+        return 1;
+    }
+    if (reader.binary()) disks = reader.disks();
+    if (disks < 1 || pegs < 3 || pegs > 16) {
+        cerr << "Error: give the number of disks (text files have no header) and 3-16 pegs" << endl;
+        return 1;
+    }
+    
+    PegSimulator sim(disks, pegs);
+    HanoiMove bad = {0, 0, 0};
+    bool legal;
+    auto start = high_resolution_clock::now();
+    uint64_t applied = validate_moves(sim, reader, bad, legal);
+    double seconds = duration<double>(high_resolution_clock::now() - start).count();
+    if (reader.malformed()) {
+        cerr << "Error: record " << applied + 1 << " of " << path << " is malformed" << endl;
+        return 1;
+    }
+    printValidation(sim, applied, legal, bad, pegs == 3 ? 2 : pegs - 1, seconds);
+    return legal && sim.solved(pegs == 3 ? 2 : pegs - 1) ? 0 : 1;
+}
+
+PegSimulator::PegSimulator(int disks, int pegs)
+    : disks(disks), pegs(pegs), words((disks + 63) / 64), rods(static_cast<size_t>(pegs) * words, 0) {
+    for (int disk = 1; disk <= disks; disk++) rods[(disk - 1) / 64] |= uint64_t(1) << ((disk - 1) % 64);
+}
+
+// Several words: the disk's word is checked like the one-word case and every
+// lower word of both pegs must be empty.
+bool PegSimulator::apply_wide(const HanoiMove& move) {
+    int word = (move.disk - 1) / 64;
+    uint64_t bit = uint64_t(1) << ((move.disk - 1) % 64), below = bit - 1;
+    uint64_t* from = &rods[move.from * words];
+    uint64_t* to = &rods[move.to * words];
+    if ((from[word] & (bit | below)) != bit || (to[word] & below)) return false;
+    for (int w = 0; w < word; w++) {
+        if (from[w] | to[w]) return false;
+    }
+    from[word] ^= bit;
+    to[word] |= bit;
+    return true;
+}
+
+string PegSimulator::explain(const HanoiMove& move) const {
+    if (move.disk < 1 || move.disk > disks) return "there is no disk " + to_string(move.disk);
+    if (move.from < 0 || move.from >= pegs || move.to < 0 || move.to >= pegs) return "no such rod";
+    if (move.from == move.to) return "source and target rod are the same";
+    string from(1, static_cast<char>('A' + move.from)), to(1, static_cast<char>('A' + move.to));
+    if (!holds(move.from, move.disk)) return "disk " + to_string(move.disk) + " is not on rod " + from;
+    if (top(move.from) != move.disk) return "disk " + to_string(top(move.from)) + " lies on top of it on rod " + from;
+    return "rod " + to + " has the smaller disk " + to_string(top(move.to)) + " on top";
+}
+
+bool PegSimulator::solved(int peg) const {
+    for (int disk = 1; disk <= disks; disk++) {
+        if (!holds(peg, disk)) return false;
+    }
+    return true;
+}
+
+int PegSimulator::top(int peg) const {
+    for (int w = 0; w < words; w++) {
+        uint64_t bits = rods[peg * words + w];
+        if (bits) return w * 64 + __builtin_ctzll(bits) + 1;
+    }
+    return 0;
+}
+
+bool MoveFileReader::open(const string& path, string& error) {
+    file = fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    buffer.resize(1 << 20);
+    if (!fill()) {
+        error = path + " is empty";
+        return false;
+    }
+    if (end - pos >= HANOI_BINARY_HEADER && memcmp(&buffer[pos], "DMHANOI1", 8) == 0) {
+        uint32_t fields[2];
+        memcpy(fields, &buffer[pos + 8], sizeof(fields));
+        if (fields[1] != HANOI_BINARY_RECORD) {
+            error = "unsupported record size in " + path;
+            return false;
+        }
+        is_binary = true;
+        header_disks = static_cast<int>(fields[0]);
+        pos += HANOI_BINARY_HEADER;
+    }
+    return true;
+}
+
+// Keeps the unread tail and tops the buffer up; false once nothing is left
+bool MoveFileReader::fill() {
+    if (pos > 0) {
+        memmove(&buffer[0], &buffer[pos], end - pos);
+        end -= pos;
+        pos = 0;
+    }
+    if (!at_eof) {
+        size_t got = fread(&buffer[end], 1, buffer.size() - end, file);
+        end += got;
+        if (end < buffer.size()) at_eof = true;
+    }
+    return end > pos;
+}
+
+bool MoveFileReader::next(HanoiMove& move) {
+    const size_t LONGEST_RECORD = 64;
+    if (end - pos < LONGEST_RECORD && !at_eof) fill();
+    if (is_binary) {
+        if (end - pos < HANOI_BINARY_RECORD) {
+            bad = end != pos;
+            return false;
+        }
+        unsigned char disk = static_cast<unsigned char>(buffer[pos]), pegs = static_cast<unsigned char>(buffer[pos + 1]);
+        move.disk = disk;
+        move.from = pegs >> 4;
+        move.to = pegs & 15;
+        pos += HANOI_BINARY_RECORD;
+        return true;
+    }
+    
+    while (pos < end && isspace(static_cast<unsigned char>(buffer[pos]))) pos++;
+    if (pos == end) return false;
+    int disk = 0;
+    while (pos < end && isdigit(static_cast<unsigned char>(buffer[pos]))) disk = disk * 10 + (buffer[pos++] - '0');
+    int rods[2];
+    for (int i = 0; i < 2; i++) {
+        while (pos < end && buffer[pos] == ' ') pos++;
+        if (pos == end || !isalpha(static_cast<unsigned char>(buffer[pos]))) {
+            bad = true;
+            return false;
+        }
+        rods[i] = toupper(buffer[pos++]) - 'A';
+    }
+    move.disk = disk;
+    move.from = rods[0];
+    move.to = rods[1];
+    return true;
+}
+
+// ========== EFFICIENCY CALCULATOR ==========
+// Candidate growth curves, compared in log space so phi^n and 2^n cannot overflow
+const ComplexityModel COMPLEXITY_MODELS[] = {
+    {"1",        [](double) { return 0.0; }},
+    {"log n",    [](double n) { return log(log2(n)); }},
+    {"n",        [](double n) { return log(n); }},
+    {"n log n",  [](double n) { return log(n * log2(n)); }},
+    {"n^1.585",  [](double n) { return 1.585 * log(n); }},
+    {"n^2",      [](double n) { return 2 * log(n); }},
+    {"phi^n",    [](double n) { return n * log(1.6180339887498949); }},
+    {"2^n",      [](double n) { return n * log(2.0); }},
+};
+
+volatile long long benchmark_sink; // keeps timed results observable
+
+int efficiencyCalculator() {
+    clearScreen();
+    displayHeader("TIME AND SPACE COMPLEXITY CALCULATOR");
+    
+    cout << "Available benchmarks:" << endl;
+    cout << "1. Fibonacci methods" << endl;
+    cout << "2. Lucas methods" << endl;
+    cout << "3. Tower of Hanoi methods" << endl;
+    cout << "4. Run all and compare" << endl;
+    cout << "5. Instrumentation report" << endl;
+    cout << "6. Fibonacci coding vs varint" << endl;
+    cout << "Enter choice: ";
+    
+    int choice;
+    cin >> choice;
+    
+    vector<BenchmarkResult> results;
+    switch(choice) {
+        case 1:
+            results = measureFibonacciTime();
+            break;
+        case 2:
+            results = measureLucasTime();
+            break;
+        case 3:
+            results = measureHanoiTime();
+            break;
+        case 4: {
+            results = measureFibonacciTime();
+            vector<BenchmarkResult> more = measureLucasTime();
+            results.insert(results.end(), more.begin(), more.end());
+            more = measureHanoiTime();
+            results.insert(results.end(), more.begin(), more.end());
+            
+            cout << "\n" << string(70, '-') << endl;
+            cout << "COMPARISON OF MEASURED COMPLEXITIES" << endl;
+            cout << string(70, '-') << endl;
+            cout << left << setw(34) << "Algorithm" << setw(12) << "Claimed" << setw(12) << "Fitted"
+                 << "Slope" << right << endl;
+            cout << string(70, '-') << endl;
+            for (size_t i = 0; i < results.size(); i++) {
+                const BenchmarkResult& result = results[i];
+                cout << left << setw(34) << (result.suite + " " + result.method)
+                     << setw(12) << ("O(" + result.claimed + ")") << setw(12) << ("O(" + result.fitted + ")")
+                     << right << fixed << setprecision(2) << result.slope << defaultfloat << endl;
+            }
+            cout << string(70, '-') << endl;
+            break;
+        }
+        case 5:
+            instrumentationReport();
+            break;
+        case 6:
+            fibonacciCodingMenu();
+            break;
+        default:
+            cout << "Invalid choice!" << endl;
+    }
+    
+    if (!results.empty()) saveBenchmarkResults(results);
+    pressEnterToContinue();
+    return 0;
+}
+
+vector<BenchmarkResult> measureFibonacciTime() {
+    cout << "\nBenchmarking Fibonacci methods (" << BENCH_SAMPLES << " samples per n)..." << endl;
+    vector<BenchmarkResult> results = run_benchmark_suite("Fibonacci", fibonacci_benchmarks(), cout);
+    printBenchmarkResults(results);
+    return results;
+}
+
+vector<BenchmarkResult> measureLucasTime() {
+    cout << "\nBenchmarking Lucas methods (" << BENCH_SAMPLES << " samples per n)..." << endl;
+    vector<BenchmarkResult> results = run_benchmark_suite("Lucas", lucas_benchmarks(), cout);
+    printBenchmarkResults(results);
+    return results;
+}
+
+vector<BenchmarkResult> measureHanoiTime() {
+    cout << "\nBenchmarking Tower of Hanoi methods (" << BENCH_SAMPLES << " samples per n)..." << endl;
+    vector<BenchmarkResult> results = run_benchmark_suite("Hanoi", hanoi_benchmarks(), cout);
+    printBenchmarkResults(results);
+    cout << "\n2^n - 1 moves is optimal, so any full solver is exponential." << endl;
+    return results;
+}
+
+// 64-bit fast doubling runs at most 7 rounds for n <= 92, so it is flat; the
+// modular variant shows the O(log n) growth. The memoized store is shared and
+// persists across queries, so after warmup it is timed as a warm O(1) lookup.
+vector<BenchmarkCase> fibonacci_benchmarks() {
+    vector<BenchmarkCase> cases;
+    cases.push_back({"Fast doubling (64-bit)", "1", fibonacci_fast_doubling, {8, 16, 32, 48, 64, 80, 92}});
+    cases.push_back({"Fast doubling (mod p)", "log n", bench_fibonacci_mod, {10, 1000, 100000, 10000000, 1000000000, 2147483647}});
+    cases.push_back({"Iterative", "n", fibonacci_iterative, {8, 16, 32, 48, 64, 80, 92}});
+    cases.push_back({"Recursive", "phi^n", fibonacci_recursive, {12, 15, 18, 21, 24, 27, 30}});
+    cases.push_back({"Memoized (warm)", "1", fibonacci_memoized, {8, 16, 32, 48, 64, 80, 92}});
+    cases.push_back({"Big integer", "n^1.585", bench_fibonacci_big, {4000, 8000, 16000, 32000, 64000, 128000, 256000}});
+    return cases;
+}
+
+vector<BenchmarkCase> lucas_benchmarks() {
+    vector<BenchmarkCase> cases;
+    cases.push_back({"Fast doubling (64-bit)", "1", lucas_fast_doubling, {8, 16, 32, 48, 64, 80, 90}});
+    cases.push_back({"Fast doubling (mod p)", "log n", bench_lucas_mod, {10, 1000, 100000, 10000000, 1000000000, 2147483647}});
+    cases.push_back({"Iterative", "n", lucas_iterative, {8, 16, 32, 48, 64, 80, 90}});
+    cases.push_back({"Recursive", "phi^n", lucas_recursive, {12, 15, 18, 21, 24, 27, 30}});
+    cases.push_back({"Memoized (warm)", "1", lucas_memoized, {8, 16, 32, 48, 64, 80, 90}});
+    cases.push_back({"Big integer", "n^1.585", bench_lucas_big, {4000, 8000, 16000, 32000, 64000, 128000, 256000}});
+    return cases;
+}
+
+vector<BenchmarkCase> hanoi_benchmarks() {
+    vector<BenchmarkCase> cases;
+    cases.push_back({"Recursive", "2^n", bench_hanoi_recursive, {8, 10, 12, 14, 16, 18, 20}});
+    cases.push_back({"Move generator", "2^n", bench_hanoi_generator, {8, 10, 12, 14, 16, 18, 20}});
+    cases.push_back({"k-th move", "1", bench_hanoi_kth_move, {8, 16, 32, 48, 64, 96, 127}});
+    cases.push_back({"Configuration", "n", bench_hanoi_configuration, {8, 16, 32, 48, 64, 96, 127}});
+    return cases;
+}
+
+vector<BenchmarkResult> run_benchmark_suite(const string& suite, const vector<BenchmarkCase>& cases, ostream& progress) {
+    vector<BenchmarkResult> results;
+    for (size_t i = 0; i < cases.size(); i++) {
+        results.push_back(run_benchmark(suite, cases[i], progress));
+    }
+    return results;
+}
+
+// For each n: warm up, double the calls per sample until a sample lasts
+// BENCH_MIN_SAMPLE_NS (so clock overhead is negligible), then collect
+// BENCH_SAMPLES samples.
+BenchmarkResult run_benchmark(const string& suite, const BenchmarkCase& bench, ostream& progress) {
+    BenchmarkResult result;
+    result.suite = suite;
+    result.method = bench.method;
+    result.claimed = bench.claimed;
+    
+    progress << "  " << bench.method << "..." << flush;
+    for (size_t i = 0; i < bench.sizes.size(); i++) {
+        int n = bench.sizes[i];
+        for (int w = 0; w < BENCH_WARMUP_RUNS; w++) benchmark_sink += bench.run(n);
+        
+        long long iterations = 1;
+        auto start = high_resolution_clock::now();
+        for (;;) {
+            start = high_resolution_clock::now();
+            for (long long it = 0; it < iterations; it++) benchmark_sink += bench.run(n);
+            double elapsed = duration<double, nano>(high_resolution_clock::now() - start).count();
+            if (elapsed >= BENCH_MIN_SAMPLE_NS || iterations >= (1LL << 24)) break;
+            iterations *= 2;
+        }
+        
+        vector<double> samples(BENCH_SAMPLES);
+        for (int s = 0; s < BENCH_SAMPLES; s++) {
+            start = high_resolution_clock::now();
+            for (long long it = 0; it < iterations; it++) benchmark_sink += bench.run(n);
+            samples[s] = duration<double, nano>(high_resolution_clock::now() - start).count() / iterations;
+        }
+        result.points.push_back(benchmark_point(n, iterations, samples));
+    }
+    progress << " done" << endl;
+    
+    fit_complexity(result);
+    return result;
+}
+
+BenchmarkPoint benchmark_point(int n, long long iterations, vector<double>& samples) {
+    sort(samples.begin(), samples.end());
+    size_t count = samples.size();
+    
+    BenchmarkPoint point;
+    point.n = n;
+    point.samples = static_cast<int>(count);
+    point.iterations = iterations;
+    point.median = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    point.p99 = samples[static_cast<size_t>(ceil(0.99 * count)) - 1]; // nearest rank
+    
+    double sum = 0;
+    for (size_t i = 0; i < count; i++) sum += samples[i];
+    point.mean = sum / count;
+    double squares = 0;
+    for (size_t i = 0; i < count; i++) squares += (samples[i] - point.mean) * (samples[i] - point.mean);
+    point.stddev = count > 1 ? sqrt(squares / (count - 1)) : 0;
+    return point;
+}
+
+// Fit median time = a + b * g(n) (a, b >= 0) for every model by least squares
+// on the relative error, so constant overheads do not hide the growth term.
+// g is normalised by its largest value so 2^n cannot overflow. Among models
+// within noise of the best residual (or within BENCH_FIT_TOLERANCE rms error)
+// the slowest-growing one wins. The log-log
+// slope is reported alongside as a model-free check.
+void fit_complexity(BenchmarkResult& result) {
+    const size_t MODEL_COUNT = sizeof(COMPLEXITY_MODELS) / sizeof(COMPLEXITY_MODELS[0]);
+    size_t count = result.points.size();
+    vector<double> residuals(MODEL_COUNT);
+    for (size_t m = 0; m < MODEL_COUNT; m++) {
+        vector<double> g(count);
+        double top = COMPLEXITY_MODELS[m].log_growth(result.points[count - 1].n);
+        for (size_t i = 0; i < count; i++) {
+            g[i] = exp(COMPLEXITY_MODELS[m].log_growth(result.points[i].n) - top);
+        }
+        
+        double sw = 0, sg = 0, sgg = 0, st = 0, sgt = 0;
+        for (size_t i = 0; i < count; i++) {
+            double t = result.points[i].median, w = 1 / (t * t);
+            sw += w;
+            sg += w * g[i];
+            sgg += w * g[i] * g[i];
+            st += w * t;
+            sgt += w * g[i] * t;
+        }
+        double det = sw * sgg - sg * sg;
+        double a = 0, b = 0;
+        if (det > 1e-12 * sw * sgg) {
+            a = (st * sgg - sg * sgt) / det;
+            b = (sw * sgt - sg * st) / det;
+        }
+        if (b <= 0) {
+            a = st / sw;
+            b = 0;
+        } else if (a < 0) {
+            a = 0;
+            b = sgt / sgg;
+        }
+        
+        for (size_t i = 0; i < count; i++) {
+            double error = (result.points[i].median - a - b * g[i]) / result.points[i].median;
+            residuals[m] += error * error;
+        }
+    }
+    
+    double best = *min_element(residuals.begin(), residuals.end());
+    double tolerance = max(best * 1.25, BENCH_FIT_TOLERANCE * BENCH_FIT_TOLERANCE * count);
+    for (size_t m = 0; m < MODEL_COUNT; m++) {
+        if (residuals[m] <= tolerance) {
+            result.fitted = COMPLEXITY_MODELS[m].name;
+            break;
+        }
+    }
+    
+    double mean_x = 0, mean_y = 0;
+    for (size_t i = 0; i < count; i++) {
+        mean_x += log(static_cast<double>(result.points[i].n)) / count;
+        mean_y += log(result.points[i].median) / count;
+    }
+    double sxy = 0, sxx = 0;
+    for (size_t i = 0; i < count; i++) {
+        double dx = log(static_cast<double>(result.points[i].n)) - mean_x;
+        sxy += dx * (log(result.points[i].median) - mean_y);
+        sxx += dx * dx;
+    }
+    result.slope = sxx > 0 ? sxy / sxx : 0;
+}
+
+void printBenchmarkResults(const vector<BenchmarkResult>& results) {
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchmarkResult& result = results[r];
+        cout << "\n" << result.suite << " - " << result.method << endl;
+        cout << string(60, '-') << endl;
+        cout << setw(8) << "n" << setw(13) << "median ns" << setw(13) << "p99 ns"
+             << setw(13) << "stddev ns" << setw(13) << "calls/sample" << endl;
+        for (size_t i = 0; i < result.points.size(); i++) {
+            const BenchmarkPoint& point = result.points[i];
+            cout << setw(8) << point.n << fixed << setprecision(1)
+                 << setw(13) << point.median << setw(13) << point.p99 << setw(13) << point.stddev
+                 << defaultfloat << setw(13) << point.iterations << endl;
+        }
+        cout << "Claimed: O(" << result.claimed << ")  Best fit: O(" << result.fitted << ")"
+             << (result.fitted == result.claimed ? "" : "  <-- differs") << endl;
+    }
+}
+
+void saveBenchmarkResults(const vector<BenchmarkResult>& results) {
+    int format;
+    cout << "\nSave results? (0=No, 1=JSON, 2=CSV): ";
+    cin >> format;
+    if (format != 1 && format != 2) return;
+    
+    string path;
+    cout << "Output file: ";
+    cin >> path;
+    ofstream out(path.c_str());
+    if (!out) {
+        cout << "Cannot open " << path << endl;
+        return;
+    }
+    if (format == 1) write_benchmark_json(out, results);
+    else write_benchmark_csv(out, results);
+    cout << "Saved to " << path << endl;
+}
+
+void write_benchmark_json(ostream& out, const vector<BenchmarkResult>& results) {
+    out << "{\n  \"compiler\": \"" << __VERSION__ << "\",\n";
+    out << "  \"warmup_runs\": " << BENCH_WARMUP_RUNS << ",\n  \"results\": [";
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchmarkResult& result = results[r];
+        out << (r ? "," : "") << "\n    {\"suite\": \"" << result.suite << "\", \"method\": \"" << result.method
+            << "\", \"claimed\": \"" << result.claimed << "\", \"fitted\": \"" << result.fitted
+            << "\", \"slope\": " << result.slope << ", \"points\": [";
+        for (size_t i = 0; i < result.points.size(); i++) {
+            const BenchmarkPoint& point = result.points[i];
+            out << (i ? ", " : "") << "\n      {\"n\": " << point.n << ", \"samples\": " << point.samples
+                << ", \"iterations\": " << point.iterations << ", \"median_ns\": " << point.median
+                << ", \"p99_ns\": " << point.p99 << ", \"mean_ns\": " << point.mean
+                << ", \"stddev_ns\": " << point.stddev << "}";
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void write_benchmark_csv(ostream& out, const vector<BenchmarkResult>& results) {
+    out << "suite,method,n,samples,iterations,median_ns,p99_ns,mean_ns,stddev_ns,claimed,fitted\n";
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchmarkResult& result = results[r];
+        for (size_t i = 0; i < result.points.size(); i++) {
+            const BenchmarkPoint& point = result.points[i];
+            out << result.suite << "," << result.method << "," << point.n << "," << point.samples << ","
+                << point.iterations << "," << point.median << "," << point.p99 << "," << point.mean << ","
+                << point.stddev << "," << result.claimed << "," << result.fitted << "\n";
+        }
+    }
+}
+
+// Command-line entry: progress goes to stderr so stdout stays machine-readable
+int runBenchmarks(const string& suite, const string& format, const char* path) {
+    if (suite != "all" && suite != "fibonacci" && suite != "lucas" && suite != "hanoi") {
+        cerr << "Error: unknown benchmark suite '" << suite << "'" << endl;
+        return 1;
+    }
+    if (format != "json" && format != "csv") {
+        cerr << "Error: unknown output format '" << format << "'" << endl;
+        return 1;
+    }
+    
+    vector<BenchmarkResult> results, more;
+    if (suite == "all" || suite == "fibonacci") {
+        more = run_benchmark_suite("Fibonacci", fibonacci_benchmarks(), cerr);
+        results.insert(results.end(), more.begin(), more.end());
+    }
+    if (suite == "all" || suite == "lucas") {
+        more = run_benchmark_suite("Lucas", lucas_benchmarks(), cerr);
+        results.insert(results.end(), more.begin(), more.end());
+    }
+    if (suite == "all" || suite == "hanoi") {
+        more = run_benchmark_suite("Hanoi", hanoi_benchmarks(), cerr);
+        results.insert(results.end(), more.begin(), more.end());
+    }
+    
+    ofstream file;
+    if (string(path) != "-") {
+        file.open(path);
+        if (!file) {
+            cerr << "Error: cannot open " << path << endl;
+            return 1;
+        }
+    }
+    ostream& out = file.is_open() ? file : cout;
+    if (format == "json") write_benchmark_json(out, results);
+    else write_benchmark_csv(out, results);
+    return 0;
+}
+
+long long bench_fibonacci_mod(int n) {
+    return static_cast<long long>(fibonacci_mod(n, 1000000007));
+}
+
+long long bench_lucas_mod(int n) {
+    return static_cast<long long>(lucas_mod(n, 1000000007));
+}
+
+long long bench_fibonacci_big(int n) {
+    return fibonacci_big(n).bitLength();
+}
+
+long long bench_lucas_big(int n) {
+    return lucas_big(n).bitLength();
+}
+
+// Same recursion as tower_of_hanoi_recursive, counting instead of printing
+long long bench_hanoi_recursive(int n) {
+    if (n == 0) return 0;
+    return bench_hanoi_recursive(n - 1) + 1 + bench_hanoi_recursive(n - 1);
+}
+
+long long bench_hanoi_generator(int n) {
+    HanoiMoves moves(n);
+    HanoiMove move;
+    long long checksum = 0;
+    while (moves.next(move)) checksum += move.disk;
+    return checksum;
+}
+
+long long bench_hanoi_kth_move(int n) {
+    return hanoi_kth_move(n, hanoi_move_count(n) / 3 + 1).disk;
+}
+
+long long bench_hanoi_configuration(int n) {
+    return hanoi_configuration(n, hanoi_move_count(n) / 3)[0];
+}
+
+// ========== INSTRUMENTATION ==========
+#ifdef DM_INSTRUMENT
+// GCC 12 inlines these into library containers and then flags the malloc/free
+// pair as mismatched with new/delete; the replacement pair is consistent.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void* operator new(size_t size) {
+    allocated_bytes.fetch_add(size, memory_order_relaxed);
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    if (void* block = malloc(size ? size : 1)) return block;
+    throw bad_alloc();
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    free(block);
+}
+#pragma GCC diagnostic pop
+#endif
+
+void reset_probes() {
+#ifdef DM_INSTRUMENT
+    for (int site = 0; site < PROBE_COUNT; site++) {
+        probe_counters[site].calls = 0;
+        probe_counters[site].peak_depth = 0;
+    }
+    allocated_bytes = 0;
+    allocation_count = 0;
+#endif
+}
+
+// Swallows the recursive Hanoi printout while it is being measured
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) { return c; }
+};
+
+void instrumentationReport() {
+#ifndef DM_INSTRUMENT
+    cout << "\nNote: probes are compiled out; rebuild with -DDM_INSTRUMENT for call" << endl;
+    cout << "counts, recursion depth, allocations and hardware counters." << endl;
+#endif
+    cout << "\nFunction to profile:" << endl;
+    cout << "1. fibonacci_recursive" << endl;
+    cout << "2. lucas_recursive" << endl;
+    cout << "3. tower_of_hanoi_recursive" << endl;
+    cout << "4. fibonacci_memoized" << endl;
+    cout << "5. lucas_memoized" << endl;
+    cout << "Enter choice: ";
+    int choice, n;
+    cin >> choice;
+    if (choice < 1 || choice > 5) {
+        cout << "Invalid choice!" << endl;
+        return;
+    }
+    cout << "Enter n: ";
+    cin >> n;
+    SharedMemo* memo = choice == 4 ? &fibonacci_memo : &lucas_memo;
+    int limit = choice <= 2 ? 40 : (choice == 3 ? 25 : memo->last());
+    if (n < 1 || n > limit) {
+        cout << "n must be between 1 and " << limit << " for this function." << endl;
+        return;
+    }
+    
+    unsigned long long hits = memo->hits(), misses = memo->misses();
+    reset_probes();
+    HardwareCounters counters;
+    NullBuffer sink;
+    streambuf* console = cout.rdbuf();
+    
+    counters.start();
+    auto start = high_resolution_clock::now();
+    switch (choice) {
+        case 1: benchmark_sink += fibonacci_recursive(n); break;
+        case 2: benchmark_sink += lucas_recursive(n); break;
+        case 3: {
+            int step = 0;
+            cout.rdbuf(&sink);
+            tower_of_hanoi_recursive(n, 'A', 'C', 'B', step);
+            cout.rdbuf(console);
+            break;
+        }
+        case 4: benchmark_sink += fibonacci_memoized(n); break;
+        case 5: benchmark_sink += lucas_memoized(n); break;
+    }
+    double elapsed = duration<double, micro>(high_resolution_clock::now() - start).count();
+    counters.stop();
+    
+    cout << "\n" << string(50, '-') << endl;
+    cout << "INSTRUMENTATION REPORT" << endl;
+    cout << string(50, '-') << endl;
+    cout << left << fixed << setprecision(2);
+    cout << setw(24) << "Wall time:" << elapsed << " us" << endl;
+    if (choice >= 4) {
+        cout << setw(24) << "Memo hits:" << memo->hits() - hits << endl;
+        cout << setw(24) << "Memo misses:" << memo->misses() - misses << endl;
+        cout << setw(24) << "Memo terms stored:" << memo->size() << endl;
+    }
+#ifdef DM_INSTRUMENT
+    if (choice <= 3) {
+        ProbeCounters& probe = probe_counters[choice - 1];
+        cout << setw(24) << "Recursive calls:" << probe.calls.load() << endl;
+        cout << setw(24) << "Peak recursion depth:" << probe.peak_depth.load() << endl;
+        cout << setw(24) << "Time per call:" << elapsed * 1000 / max(1ULL, probe.calls.load()) << " ns" << endl;
+    }
+    cout << setw(24) << "Heap allocations:" << allocation_count.load() << endl;
+    cout << setw(24) << "Bytes allocated:" << allocated_bytes.load() << endl;
+#endif
+    if (counters.available()) {
+        cout << setw(24) << "CPU cycles:" << counters.cycles << endl;
+        cout << setw(24) << "Instructions:" << counters.instructions << endl;
+        cout << setw(24) << "Instructions/cycle:" << static_cast<double>(counters.instructions) / max(1ULL, counters.cycles) << endl;
+        cout << setw(24) << "Cache misses:" << counters.cache_misses << endl;
+    } else {
+        cout << "Hardware counters: unavailable" << endl;
+    }
+    cout << right << defaultfloat << string(50, '-') << endl;
+}
+
+#ifdef DM_HAVE_PERF
+// The three events form one group led by the cycle counter, so they are
+// enabled, disabled and read together.
+HardwareCounters::HardwareCounters() : cycles(0), instructions(0), cache_misses(0) {
+    static const unsigned long long EVENTS[3] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES
+    };
+    for (int i = 0; i < 3; i++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = EVENTS[i];
+        attr.disabled = (i == 0);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        fds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, i ? fds[0] : -1, 0));
+        if (fds[i] < 0) {
+            for (int j = 0; j < i; j++) close(fds[j]);
+            fds[0] = fds[1] = fds[2] = -1;
+            return;
+        }
+    }
+}
+
+HardwareCounters::~HardwareCounters() {
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+}
+
+void HardwareCounters::start() {
+    if (!available()) return;
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void HardwareCounters::stop() {
+    if (!available()) return;
+    ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    unsigned long long values[4] = {0, 0, 0, 0}; // count, then one value per event
+    if (read(fds[0], values, sizeof(values)) == static_cast<ssize_t>(sizeof(values))) {
+        cycles = values[1];
+        instructions = values[2];
+        cache_misses = values[3];
+    }
+}
+#else
+HardwareCounters::HardwareCounters() : cycles(0), instructions(0), cache_misses(0) {
+    fds[0] = fds[1] = fds[2] = -1;
+}
+
+HardwareCounters::~HardwareCounters() {}
+void HardwareCounters::start() {}
+void HardwareCounters::stop() {}
+#endif
+
+// ========== GRAPH VISUALIZER ==========
+void graphVisualizer() {
+    clearScreen();
+    displayHeader("VISUAL GRAPHS");
+    
+    cout << "Available graphs:" << endl;
+    cout << "1. Fibonacci sequence growth (digits of F(n))" << endl;
+    cout << "2. Lucas sequence growth (digits of L(n))" << endl;
+    cout << "3. Tower of Hanoi moves growth (digits of 2^n - 1)" << endl;
+    cout << "4. Distance of F(n+1)/F(n) from the golden ratio" << endl;
+    cout << "5. Time to compute F(n) exactly" << endl;
+    cout << "Enter choice: ";
+    
+    int choice;
+    long long n;
+    cin >> choice;
+    if (choice < 1 || choice > 5) {
+        cout << "Invalid choice!" << endl;
+        pressEnterToContinue();
+        return;
+    }
+    cout << "Enter largest n (1-" << PLOT_MAX_N << "): ";
+    cin >> n;
+    if (n < 1 || n > PLOT_MAX_N) {
+        cout << "n must be between 1 and " << PLOT_MAX_N << "!" << endl;
+        pressEnterToContinue();
+        return;
+    }
+    
+    int output;
+    cout << "Output (1=terminal, 2=SVG file, 3=PPM image): ";
+    cin >> output;
+    int columns = output == 1 ? 60 : 800;
+    
+    PlotData plot;
+    switch(choice) {
+        case 1:
+            plot = make_plot("Fibonacci growth", "log10 F(n)", 1, n, columns, false);
+            plot_curve(plot, fibonacci_log10);
+            break;
+        case 2:
+            plot = make_plot("Lucas growth", "log10 L(n)", 1, n, columns, false);
+            plot_curve(plot, lucas_log10);
+            break;
+        case 3:
+            plot = make_plot("Tower of Hanoi moves", "log10 (2^n - 1)", 1, n, columns, false);
+            plot_curve(plot, hanoi_log10);
+            break;
+        case 4:
+            plot = make_plot("F(n+1)/F(n) - golden ratio", "log10 |error|", 1, n, columns, false);
+            plot_curve(plot, golden_ratio_error_log10);
+            break;
+        case 5:
+            plot = make_plot("Time to compute F(n) exactly", "log10 ms", 1, n, columns, true);
+            plot_timing(plot, 40);
+            break;
+    }
+    
+    if (output == 2 || output == 3) {
+        string path;
+        cout << "Output file: ";
+        cin >> path;
+        bool written = output == 2 ? write_plot_svg(plot, path) : write_plot_ppm(plot, path, 400);
+        cout << (written ? "Saved to " : "Cannot write ") << path << endl;
+    } else {
+        printPlot(plot, 16);
+    }
+    
+    pressEnterToContinue();
+}
+
+PlotData make_plot(const string& title, const string& y_label, long long first, long long last, int columns, bool log_x) {
+    PlotData plot;
+    plot.title = title;
+    plot.y_label = y_label;
+    plot.first = first;
+    plot.last = max(last, first);
+    plot.log_x = log_x;
+    plot.low.assign(columns, 0);
+    plot.high.assign(columns, 0);
+    plot.filled.assign(columns, 0);
+    plot.y_min = HUGE_VAL; // empty until the first point
+    plot.y_max = -HUGE_VAL;
+    return plot;
+}
+
+// Min/max downsampling: each point widens the range of its column
+void plot_add(PlotData& plot, long long n, double y) {
+    int columns = static_cast<int>(plot.low.size());
+    double position = 0;
+    if (plot.last > plot.first) {
+        position = plot.log_x ? log(static_cast<double>(n) / plot.first) / log(static_cast<double>(plot.last) / plot.first)
+                              : static_cast<double>(n - plot.first) / (plot.last - plot.first);
+    }
+    int column = min(columns - 1, max(0, static_cast<int>(position * (columns - 1) + 0.5)));
+    if (!plot.filled[column]) {
+        plot.low[column] = plot.high[column] = y;
+        plot.filled[column] = 1;
+    } else {
+        plot.low[column] = min(plot.low[column], y);
+        plot.high[column] = max(plot.high[column], y);
+    }
+    plot.y_min = min(plot.y_min, y);
+    plot.y_max = max(plot.y_max, y);
+}
+
+void plot_curve(PlotData& plot, double (*value)(long long)) {
+    for (long long n = plot.first; n <= plot.last; n++) plot_add(plot, n, value(n));
+}
+
+// Samples are spaced geometrically; each is the best of three runs
+void plot_timing(PlotData& plot, int samples) {
+    long long previous = 0;
+    for (int i = 0; i < samples; i++) {
+        long long n = static_cast<long long>(plot.first * pow(static_cast<double>(plot.last) / plot.first,
+                                                              static_cast<double>(i) / (samples - 1)) + 0.5);
+        if (n == previous) continue;
+        previous = n;
+        double best = 0;
+        for (int run = 0; run < 3; run++) {
+            auto start = high_resolution_clock::now();
+            benchmark_sink += fibonacci_big(n).bitLength();
+            double elapsed = duration<double, milli>(high_resolution_clock::now() - start).count();
+            best = run == 0 ? elapsed : min(best, elapsed);
+        }
+        plot_add(plot, n, log10(max(best, 1e-6)));
+        cout << "\rTiming F(" << n << ")..." << string(10, ' ') << flush;
+    }
+    cout << "\r" << string(40, ' ') << "\r";
+}
+
+// Magnitudes without big integers: exact from the 64-bit tables, then
+// Binet's formula (the psi^n term is far below double precision there).
+double fibonacci_log10(long long n) {
+    static const double LOG_PHI = log10((1 + sqrt(5.0)) / 2), LOG_SQRT5 = log10(sqrt(5.0));
+    if (n < static_cast<long long>(FIBONACCI_TABLE.size())) return log10(static_cast<double>(FIBONACCI_TABLE[n]));
+    return n * LOG_PHI - LOG_SQRT5;
+}
+
+double lucas_log10(long long n) {
+    static const double LOG_PHI = log10((1 + sqrt(5.0)) / 2);
+    if (n < static_cast<long long>(LUCAS_TABLE.size())) return log10(static_cast<double>(LUCAS_TABLE[n]));
+    return n * LOG_PHI;
+}
+
+double hanoi_log10(long long n) {
+    if (n < 64) return log10(static_cast<double>((uint64_t(1) << n) - 1));
+    return n * log10(2.0);
+}
+
+// F(n+1) - phi F(n) = psi^n, so |F(n+1)/F(n) - phi| = |psi|^n / F(n)
+double golden_ratio_error_log10(long long n) {
+    static const double LOG_PSI = log10((sqrt(5.0) - 1) / 2);
+    return n * LOG_PSI - fibonacci_log10(n);
+}
+
+void printPlot(const PlotData& plot, int rows) {
+    int columns = static_cast<int>(plot.low.size());
+    double span = plot.y_max > plot.y_min ? plot.y_max - plot.y_min : 1;
+    
+    cout << "\n" << plot.title << " (" << plot.y_label << ")" << endl;
+    for (int row = rows - 1; row >= 0; row--) {
+        double bottom = plot.y_min + span * row / rows, top = plot.y_min + span * (row + 1) / rows;
+        if (row == rows - 1) cout << setw(12) << setprecision(4) << plot.y_max << " |";
+        else if (row == 0) cout << setw(12) << setprecision(4) << plot.y_min << " |";
+        else cout << string(12, ' ') << " |";
+        for (int c = 0; c < columns; c++) {
+            bool hit = plot.filled[c] && plot.high[c] >= bottom && (plot.low[c] < top || row == rows - 1);
+            cout << (hit ? '#' : ' ');
+        }
+        cout << '\n';
+    }
+    cout << setprecision(6) << string(13, ' ') << "+" << string(columns, '-') << endl;
+    string left = "n = " + to_string(plot.first), right = to_string(plot.last) + (plot.log_x ? " (log scale)" : "");
+    cout << string(14, ' ') << left << string(max(1, columns - static_cast<int>(left.size() + right.size())), ' ')
+         << right << endl;
+}
+
+// Written element by element from the column ranges: one vertical segment
+// per column (the min/max band) plus a polyline through the column centres.
+bool write_plot_svg(const PlotData& plot, const string& path) {
+    ofstream out(path.c_str());
+    if (!out) return false;
+    const int WIDTH = 900, HEIGHT = 480, LEFT = 80, TOP = 40;
+    int columns = static_cast<int>(plot.low.size());
+    double span = plot.y_max > plot.y_min ? plot.y_max - plot.y_min : 1;
+    double plot_width = WIDTH - LEFT - 20, plot_height = HEIGHT - TOP - 60;
+    
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << WIDTH << "\" height=\"" << HEIGHT << "\">\n";
+    out << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+    out << "<text x=\"" << WIDTH / 2 << "\" y=\"24\" text-anchor=\"middle\" font-family=\"sans-serif\">"
+        << plot.title << "</text>\n";
+    out << "<g font-family=\"sans-serif\" font-size=\"12\">\n";
+    out << "<text x=\"" << LEFT - 6 << "\" y=\"" << TOP + 4 << "\" text-anchor=\"end\">" << plot.y_max << "</text>\n";
+    out << "<text x=\"" << LEFT - 6 << "\" y=\"" << TOP + plot_height << "\" text-anchor=\"end\">" << plot.y_min << "</text>\n";
+    out << "<text x=\"" << LEFT << "\" y=\"" << TOP + plot_height + 20 << "\">n = " << plot.first << "</text>\n";
+    out << "<text x=\"" << LEFT + plot_width << "\" y=\"" << TOP + plot_height + 20 << "\" text-anchor=\"end\">"
+        << plot.last << (plot.log_x ? " (log scale)" : "") << "</text>\n";
+    out << "<text x=\"" << LEFT + plot_width / 2 << "\" y=\"" << HEIGHT - 12 << "\" text-anchor=\"middle\">"
+        << plot.y_label << " against n</text>\n</g>\n";
+    out << "<rect x=\"" << LEFT << "\" y=\"" << TOP << "\" width=\"" << plot_width << "\" height=\"" << plot_height
+        << "\" fill=\"none\" stroke=\"#888\"/>\n";
+    
+    out << "<g stroke=\"#9ecae1\">\n";
+    for (int c = 0; c < columns; c++) {
+        if (!plot.filled[c] || plot.high[c] == plot.low[c]) continue;
+        double x = LEFT + plot_width * c / max(1, columns - 1);
+        out << "<line x1=\"" << x << "\" x2=\"" << x << "\" y1=\"" << TOP + plot_height * (plot.y_max - plot.high[c]) / span
+            << "\" y2=\"" << TOP + plot_height * (plot.y_max - plot.low[c]) / span << "\"/>\n";
+    }
+    out << "</g>\n<polyline fill=\"none\" stroke=\"#3182bd\" stroke-width=\"1.5\" points=\"";
+    for (int c = 0; c < columns; c++) {
+        if (!plot.filled[c]) continue;
+        out << LEFT + plot_width * c / max(1, columns - 1) << ","
+            << TOP + plot_height * (plot.y_max - (plot.low[c] + plot.high[c]) / 2) / span << " ";
+    }
+    out << "\"/>\n</svg>\n";
+    return static_cast<bool>(out);
+}
+
+// Binary PPM written one row at a time; a pixel is dark when it lies in its
+// column's range, widened to meet the neighbouring columns so the curve stays
+// connected.
+bool write_plot_ppm(const PlotData& plot, const string& path, int height) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    int columns = static_cast<int>(plot.low.size());
+    double span = plot.y_max > plot.y_min ? plot.y_max - plot.y_min : 1;
+    
+    vector<int> top(columns, -1), bottom(columns, -1);
+    int previous = -1;
+    for (int c = 0; c < columns; c++) {
+        if (!plot.filled[c]) continue;
+        top[c] = static_cast<int>((plot.y_max - plot.high[c]) / span * (height - 1) + 0.5);
+        bottom[c] = static_cast<int>((plot.y_max - plot.low[c]) / span * (height - 1) + 0.5);
+        if (previous >= 0) {
+            int middle = (top[previous] + bottom[previous]) / 2;
+            top[c] = min(top[c], middle);
+            bottom[c] = max(bottom[c], middle);
+        }
+        previous = c;
+    }
+    
+    fprintf(file, "P6\n%d %d\n255\n", columns, height);
+    vector<unsigned char> row(columns * 3);
+    for (int y = 0; y < height; y++) {
+        for (int c = 0; c < columns; c++) {
+            bool ink = top[c] >= 0 && y >= top[c] && y <= bottom[c];
+            row[3 * c] = ink ? 49 : 255;
+            row[3 * c + 1] = ink ? 130 : 255;
+            row[3 * c + 2] = ink ? 189 : 255;
+        }
+        fwrite(&row[0], 1, row.size(), file);
+    }
+    return fclose(file) == 0;
+}
+// ========== BIG INTEGER ==========
+// Operand sizes (in 32-bit limbs) above which the faster multiplications win.
+const size_t KARATSUBA_THRESHOLD = 40;
+const size_t TOOM3_THRESHOLD = 160;
+
+BigInt::BigInt(unsigned long long value) {
+    while (value > 0) {
+        limbs.push_back(static_cast<uint32_t>(value));
+        value >>= 32;
+    }
+}
+
+size_t BigInt::bitLength() const {
+    if (limbs.empty()) return 0;
+    return (limbs.size() - 1) * 32 + (32 - __builtin_clz(limbs.back()));
+}
+
+unsigned long long BigInt::mod(unsigned long long m) const {
+    unsigned __int128 remainder = 0;
+    for (size_t i = limbs.size(); i-- > 0;) {
+        remainder = ((remainder << 32) | limbs[i]) % m;
+    }
+    return static_cast<unsigned long long>(remainder);
+}
+
+string BigInt::toString() const {
+    string text;
+    limbs_append_decimal(limbs, text);
+    return text;
+}
+
+BigInt& BigInt::operator+=(const BigInt& other) {
+    limbs = limbs_add(limbs, other.limbs);
+    return *this;
+}
+
+BigInt& BigInt::operator-=(const BigInt& other) {
+    limbs = limbs_sub(limbs, other.limbs);
+    return *this;
+}
+
+BigInt& BigInt::operator>>=(int bits) {
+    size_t words = bits / 32;
+    bits %= 32;
+    if (words >= limbs.size()) {
+        limbs.clear();
+        return *this;
+    }
+    limbs.erase(limbs.begin(), limbs.begin() + words);
+    if (bits > 0) {
+        for (size_t i = 0; i < limbs.size(); i++) {
+            uint32_t high = (i + 1 < limbs.size()) ? limbs[i + 1] << (32 - bits) : 0;
+            limbs[i] = (limbs[i] >> bits) | high;
         }
-    } while(choice != 0);
+    }
+    limbs_trim(limbs);
+    return *this;
 }
 
-long long lucas_iterative(int n) {
-    if (n < 0) return -1;
-    if (n == 0) return 2;
-    if (n == 1) return 1;
-    
-    long long a = 2, b = 1;
-    for (int i = 2; i <= n; i++) {
-        long long next = a + b;
-        a = b;
-        b = next;
+BigInt BigInt::mulSmall(uint32_t factor) const {
+    BigInt result;
+    result.limbs.reserve(limbs.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < limbs.size(); i++) {
+        uint64_t cur = static_cast<uint64_t>(limbs[i]) * factor + carry;
+        result.limbs.push_back(static_cast<uint32_t>(cur));
+        carry = cur >> 32;
     }
-    return b;
+    if (carry) result.limbs.push_back(static_cast<uint32_t>(carry));
+    limbs_trim(result.limbs);
+    return result;
 }
 
-long long lucas_recursive(int n) {
-    if (n < 0) return -1;
-    if (n == 0) return 2;
-    if (n == 1) return 1;
-    return lucas_recursive(n-1) + lucas_recursive(n-2);
+BigInt operator+(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    result.limbs = limbs_add(a.limbs, b.limbs);
+    return result;
 }
 
-long long lucas_memoized(int n, vector<long long>& memo) {
-    if (n == 0) return 2;
-    if (n == 1) return 1;
-    if (memo[n] != -1) return memo[n];
-    
-    memo[n] = lucas_memoized(n-1, memo) + lucas_memoized(n-2, memo);
-    return memo[n];
+BigInt operator-(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    result.limbs = limbs_sub(a.limbs, b.limbs);
+    return result;
 }
 
-vector<long long> lucas_sequence(int n) {
-    vector<long long> seq;
-    if (n < 0) return seq;
-    
-    if (n >= 0) seq.push_back(2);
-    if (n >= 1) seq.push_back(1);
-    
-    for (int i = 2; i <= n; i++) {
-        seq.push_back(seq[i-1] + seq[i-2]);
+BigInt operator*(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    result.limbs = limbs_mul(a.limbs, b.limbs);
+    return result;
+}
+
+int compare(const BigInt& a, const BigInt& b) {
+    return limbs_compare(a.limbs, b.limbs);
+}
+
+void limbs_trim(Limbs& a) {
+    while (!a.empty() && a.back() == 0) a.pop_back();
+}
+
+int limbs_compare(const Limbs& a, const Limbs& b) {
+    if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+    for (size_t i = a.size(); i-- > 0;) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
     }
-    return seq;
+    return 0;
 }
 
-// ========== TOWER OF HANOI ==========
-void towerOfHanoi() {
-    clearScreen();
-    displayHeader("TOWER OF HANOI CALCULATOR");
-    
-    int n;
-    cout << "Enter number of disks (1-10 recommended): ";
-    cin >> n;
+Limbs limbs_add(const Limbs& a, const Limbs& b) {
+    const Limbs& longer = a.size() >= b.size() ? a : b;
+    const Limbs& shorter = a.size() >= b.size() ? b : a;
     
-    if (n <= 0) {
-        cout << "Number of disks must be positive!" << endl;
-        pressEnterToContinue();
-        return;
+    Limbs result(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); i++) {
+        uint64_t cur = carry + longer[i] + (i < shorter.size() ? shorter[i] : 0);
+        result[i] = static_cast<uint32_t>(cur);
+        carry = cur >> 32;
+    }
+    result[longer.size()] = static_cast<uint32_t>(carry);
+    limbs_trim(result);
+    return result;
+}
+
+Limbs limbs_sub(const Limbs& a, const Limbs& b) {
+    Limbs result(a.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        int64_t cur = static_cast<int64_t>(a[i]) - borrow - (i < b.size() ? b[i] : 0);
+        borrow = cur < 0 ? 1 : 0;
+        result[i] = static_cast<uint32_t>(cur + (borrow << 32));
     }
+    limbs_trim(result);
+    return result;
+}
+
+// acc += x * 2^(32 * shift)
+void limbs_add_shifted(Limbs& acc, const Limbs& x, size_t shift) {
+    if (x.empty()) return;
+    if (acc.size() < x.size() + shift + 1) acc.resize(x.size() + shift + 1, 0);
     
-    int choice;
-    cout << "\nChoose solution method:" << endl;
-    cout << "1. Recursive solution with steps" << endl;
-    cout << "2. Iterative solution" << endl;
-    cout << "3. Calculate minimum moves only" << endl;
-    cout << "Enter choice: ";
-    cin >> choice;
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < x.size(); i++) {
+        uint64_t cur = carry + acc[i + shift] + x[i];
+        acc[i + shift] = static_cast<uint32_t>(cur);
+        carry = cur >> 32;
+    }
+    for (i += shift; carry && i < acc.size(); i++) {
+        uint64_t cur = carry + acc[i];
+        acc[i] = static_cast<uint32_t>(cur);
+        carry = cur >> 32;
+    }
+    if (carry) acc.push_back(static_cast<uint32_t>(carry));
+    limbs_trim(acc);
+}
+
+// Divides a in place by a single limb and returns the remainder
+uint32_t limbs_divmod_small(Limbs& a, uint32_t d) {
+    uint64_t remainder = 0;
+    for (size_t i = a.size(); i-- > 0;) {
+        uint64_t cur = (remainder << 32) | a[i];
+        a[i] = static_cast<uint32_t>(cur / d);
+        remainder = cur % d;
+    }
+    limbs_trim(a);
+    return static_cast<uint32_t>(remainder);
+}
+
+// Knuth's algorithm D: normalise so the divisor's top limb has its high bit
+// set, then estimate each quotient limb from the top two limbs of the
+// running remainder (off by at most two, corrected by the add-back).
+Limbs limbs_divmod(const Limbs& a, const Limbs& b, Limbs& remainder) {
+    if (limbs_compare(a, b) < 0) {
+        remainder = a;
+        return Limbs();
+    }
+    if (b.size() == 1) {
+        Limbs quotient = a;
+        uint32_t r = limbs_divmod_small(quotient, b[0]);
+        remainder = r ? Limbs(1, r) : Limbs();
+        return quotient;
+    }
     
-    cout << "\nMinimum moves required: " << (pow(2, n) - 1) << endl;
+    int shift = __builtin_clz(b.back());
+    size_t n = b.size(), m = a.size() - n;
+    Limbs v(n), u(a.size() + 1);
+    for (size_t i = n; i-- > 0;) {
+        v[i] = (b[i] << shift) | (shift && i > 0 ? b[i - 1] >> (32 - shift) : 0);
+    }
+    u[a.size()] = shift ? a.back() >> (32 - shift) : 0;
+    for (size_t i = a.size(); i-- > 0;) {
+        u[i] = (a[i] << shift) | (shift && i > 0 ? a[i - 1] >> (32 - shift) : 0);
+    }
     
-    switch(choice) {
-        case 1: {
-            cout << "\nRecursive solution steps:" << endl;
-            cout << string(50, '-') << endl;
-            int step = 0;
-            tower_of_hanoi_recursive(n, 'A', 'C', 'B', step);
-            cout << string(50, '-') << endl;
-            cout << "Total steps: " << step << endl;
-            break;
+    Limbs quotient(m + 1);
+    const uint64_t BASE = 1ULL << 32;
+    for (size_t j = m + 1; j-- > 0;) {
+        uint64_t numerator = (static_cast<uint64_t>(u[j + n]) << 32) | u[j + n - 1];
+        uint64_t q_hat = numerator / v[n - 1], r_hat = numerator % v[n - 1];
+        while (q_hat >= BASE || q_hat * v[n - 2] > ((r_hat << 32) | u[j + n - 2])) {
+            q_hat--;
+            r_hat += v[n - 1];
+            if (r_hat >= BASE) break;
         }
-        case 2: {
-            cout << "\nIterative solution steps:" << endl;
-            cout << string(50, '-') << endl;
-            tower_of_hanoi_iterative(n);
-            break;
+        
+        // u[j..j+n] -= q_hat * v
+        int64_t borrow = 0;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t product = q_hat * v[i] + carry;
+            carry = product >> 32;
+            int64_t cur = static_cast<int64_t>(u[i + j]) - borrow - static_cast<int64_t>(product & 0xffffffffULL);
+            u[i + j] = static_cast<uint32_t>(cur);
+            borrow = cur < 0 ? 1 : 0;
         }
-        case 3: {
-            cout << "\nMinimum moves calculation:" << endl;
-            cout << "Formula: 2^n - 1 = " << (pow(2, n) - 1) << endl;
-            break;
+        int64_t top = static_cast<int64_t>(u[j + n]) - borrow - static_cast<int64_t>(carry);
+        u[j + n] = static_cast<uint32_t>(top);
+        
+        if (top < 0) {
+            // Estimate was one too large: add v back
+            q_hat--;
+            uint64_t sum_carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint64_t sum = static_cast<uint64_t>(u[i + j]) + v[i] + sum_carry;
+                u[i + j] = static_cast<uint32_t>(sum);
+                sum_carry = sum >> 32;
+            }
+            u[j + n] += static_cast<uint32_t>(sum_carry);
         }
-        default:
-            cout << "Invalid choice!" << endl;
+        quotient[j] = static_cast<uint32_t>(q_hat);
     }
     
-    pressEnterToContinue();
+    remainder.assign(n, 0);
+    for (size_t i = 0; i < n; i++) {
+        remainder[i] = (u[i] >> shift) | (shift ? u[i + 1] << (32 - shift) : 0);
+    }
+    limbs_trim(remainder);
+    limbs_trim(quotient);
+    return quotient;
 }
 
-void tower_of_hanoi_recursive(int n, char from, char to, char aux, int& step) {
-    if (n == 1) {
-        step++;
-        cout << "Step " << step << ": Move disk 1 from rod " 
-             << from << " to rod " << to << endl;
-        return;
-    }
+// floor(sqrt(a)) by Newton's iteration from a power of two above the root
+Limbs limbs_isqrt(const Limbs& a) {
+    if (a.empty()) return Limbs();
+    size_t bits = (a.size() - 1) * 32 + (32 - __builtin_clz(a.back()));
+    size_t root_bit = (bits + 1) / 2;
+    Limbs x(root_bit / 32 + 1, 0);
+    x[root_bit / 32] = 1U << (root_bit % 32);
     
-    tower_of_hanoi_recursive(n - 1, from, aux, to, step);
-    step++;
-    cout << "Step " << step << ": Move disk " << n 
-         << " from rod " << from << " to rod " << to << endl;
-    tower_of_hanoi_recursive(n - 1, aux, to, from, step);
+    for (;;) {
+        Limbs remainder;
+        BigInt y;
+        y.limbs = limbs_add(x, limbs_divmod(a, x, remainder));
+        y >>= 1;
+        if (limbs_compare(y.limbs, x) >= 0) return x;
+        x = y.limbs;
+    }
 }
 
-void tower_of_hanoi_iterative(int n) {
-    // Using mathematical pattern
-    char s = 'A', d = 'C', a = 'B';
-    
-    // If odd number of disks, swap destination and auxiliary
-    if (n % 2 == 1) {
-        d = 'B';
-        a = 'C';
+// Decimal digits only, nine at a time
+bool parse_big(const string& text, BigInt& value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != string::npos) return false;
+    value = BigInt(0);
+    size_t head = text.length() % 9 == 0 ? 9 : text.length() % 9;
+    for (size_t pos = 0; pos < text.length(); pos += (pos == 0 ? head : 9)) {
+        size_t len = pos == 0 ? head : 9;
+        uint32_t chunk = 0;
+        from_chars(text.data() + pos, text.data() + pos + len, chunk);
+        value = value.mulSmall(pos == 0 ? 1 : 1000000000) + BigInt(chunk);
     }
+    return true;
+}
+
+static Limbs limbs_slice(const Limbs& a, size_t from, size_t to) {
+    if (from >= a.size()) return Limbs();
+    Limbs part(a.begin() + from, a.begin() + min(to, a.size()));
+    limbs_trim(part);
+    return part;
+}
+
+Limbs limbs_mul(const Limbs& a, const Limbs& b) {
+    if (a.size() < b.size()) return limbs_mul(b, a);
+    if (b.empty()) return Limbs();
+    if (b.size() < KARATSUBA_THRESHOLD) return limbs_mul_schoolbook(a, b);
+    if (b.size() >= NTT_THRESHOLD) return limbs_mul_ntt(a, b);
     
-    long long total_moves = pow(2, n) - 1;
+    // Very unbalanced operands: multiply b against slices of a
+    if (a.size() >= 2 * b.size()) {
+        Limbs result;
+        for (size_t offset = 0; offset < a.size(); offset += b.size()) {
+            limbs_add_shifted(result, limbs_mul(limbs_slice(a, offset, offset + b.size()), b), offset);
+        }
+        return result;
+    }
     
-    for (int move = 1; move <= total_moves; move++) {
-        if (move % 3 == 1) {
-            cout << "Step " << move << ": Move disk from rod " 
-                 << s << " to rod " << d << endl;
-        } else if (move % 3 == 2) {
-            cout << "Step " << move << ": Move disk from rod " 
-                 << s << " to rod " << a << endl;
-        } else {
-            cout << "Step " << move << ": Move disk from rod " 
-                 << a << " to rod " << d << endl;
+    if (b.size() < TOOM3_THRESHOLD) return limbs_mul_karatsuba(a, b);
+    return limbs_mul_toom3(a, b);
+}
+
+Limbs limbs_mul_schoolbook(const Limbs& a, const Limbs& b) {
+    Limbs result(a.size() + b.size(), 0);
+    for (size_t i = 0; i < a.size(); i++) {
+        uint64_t ai = a[i];
+        if (ai == 0) continue;
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b.size(); j++) {
+            uint64_t cur = ai * b[j] + result[i + j] + carry;
+            result[i + j] = static_cast<uint32_t>(cur);
+            carry = cur >> 32;
         }
+        result[i + b.size()] = static_cast<uint32_t>(carry);
     }
-    cout << "Total steps: " << total_moves << endl;
+    limbs_trim(result);
+    return result;
 }
 
-// ========== EFFICIENCY CALCULATOR ==========
-int efficiencyCalculator() {
-    clearScreen();
-    displayHeader("TIME AND SPACE COMPLEXITY CALCULATOR");
+// (a1 x + a0)(b1 x + b0) with three half-size products:
+//   z1 = (a0 + a1)(b0 + b1) - a0 b0 - a1 b1
+Limbs limbs_mul_karatsuba(const Limbs& a, const Limbs& b) {
+    size_t half = (a.size() + 1) / 2;
+    Limbs a0 = limbs_slice(a, 0, half), a1 = limbs_slice(a, half, a.size());
+    Limbs b0 = limbs_slice(b, 0, half), b1 = limbs_slice(b, half, b.size());
     
-    cout << "Available analyses:" << endl;
-    cout << "1. Fibonacci sequence complexities" << endl;
-    cout << "2. Lucas sequence complexities" << endl;
-    cout << "3. Tower of Hanoi complexities" << endl;
-    cout << "4. Compare all methods" << endl;
-    cout << "Enter choice: ";
+    Limbs z0 = limbs_mul(a0, b0);
+    Limbs z2 = limbs_mul(a1, b1);
+    Limbs z1 = limbs_mul(limbs_add(a0, a1), limbs_add(b0, b1));
+    z1 = limbs_sub(limbs_sub(z1, z0), z2);
     
-    int choice;
-    cin >> choice;
+    Limbs result = z0;
+    limbs_add_shifted(result, z1, half);
+    limbs_add_shifted(result, z2, 2 * half);
+    return result;
+}
+
+SignedLimbs signed_add(const SignedLimbs& x, const SignedLimbs& y) {
+    if (x.neg == y.neg) return SignedLimbs(limbs_add(x.mag, y.mag), x.neg);
+    if (limbs_compare(x.mag, y.mag) >= 0) return SignedLimbs(limbs_sub(x.mag, y.mag), x.neg);
+    return SignedLimbs(limbs_sub(y.mag, x.mag), y.neg);
+}
+
+SignedLimbs signed_sub(const SignedLimbs& x, const SignedLimbs& y) {
+    return signed_add(x, SignedLimbs(y.mag, !y.neg));
+}
+
+SignedLimbs signed_mul(const SignedLimbs& x, const SignedLimbs& y) {
+    return SignedLimbs(limbs_mul(x.mag, y.mag), x.neg != y.neg);
+}
+
+SignedLimbs signed_div_exact(SignedLimbs x, uint32_t d) {
+    limbs_divmod_small(x.mag, d);
+    return SignedLimbs(x.mag, x.neg);
+}
+
+// Toom-Cook 3-way: evaluate at 0, 1, -1, -2 and infinity, multiply the five
+// third-size values and interpolate (Bodrato's sequence).
+Limbs limbs_mul_toom3(const Limbs& a, const Limbs& b) {
+    size_t k = (a.size() + 2) / 3;
+    SignedLimbs a0(limbs_slice(a, 0, k)), a1(limbs_slice(a, k, 2 * k)), a2(limbs_slice(a, 2 * k, a.size()));
+    SignedLimbs b0(limbs_slice(b, 0, k)), b1(limbs_slice(b, k, 2 * k)), b2(limbs_slice(b, 2 * k, b.size()));
     
-    switch(choice) {
-        case 1:
-            measureFibonacciTime();
-            break;
-        case 2:
-            measureLucasTime();
-            break;
-        case 3:
-            measureHanoiTime();
-            break;
-        case 4: {
-            cout << "\n" << string(60, '-') << endl;
-            cout << "COMPARISON OF COMPLEXITIES" << endl;
-            cout << string(60, '-') << endl;
-            cout << setw(20) << "Algorithm" << setw(15) << "Time" << setw(15) << "Space" << endl;
-            cout << string(60, '-') << endl;
-            cout << setw(20) << "Fibonacci Iterative" << setw(15) << "O(n)" << setw(15) << "O(1)" << endl;
-            cout << setw(20) << "Fibonacci Recursive" << setw(15) << "O(2^n)" << setw(15) << "O(n)" << endl;
-            cout << setw(20) << "Fibonacci Memoized" << setw(15) << "O(n)" << setw(15) << "O(n)" << endl;
-            cout << setw(20) << "Lucas Iterative" << setw(15) << "O(n)" << setw(15) << "O(1)" << endl;
-            cout << setw(20) << "Lucas Recursive" << setw(15) << "O(2^n)" << setw(15) << "O(n)" << endl;
-            cout << setw(20) << "Tower of Hanoi" << setw(15) << "O(2^n)" << setw(15) << "O(n)" << endl;
-            cout << string(60, '-') << endl;
-            break;
+    // Evaluation
+    SignedLimbs pa = signed_add(a0, a2);
+    SignedLimbs pa1 = signed_add(pa, a1);
+    SignedLimbs pam1 = signed_sub(pa, a1);
+    SignedLimbs pam2 = signed_sub(signed_add(signed_add(pam1, a2), signed_add(pam1, a2)), a0);
+    
+    SignedLimbs pb = signed_add(b0, b2);
+    SignedLimbs pb1 = signed_add(pb, b1);
+    SignedLimbs pbm1 = signed_sub(pb, b1);
+    SignedLimbs pbm2 = signed_sub(signed_add(signed_add(pbm1, b2), signed_add(pbm1, b2)), b0);
+    
+    // Pointwise products
+    SignedLimbs r0 = signed_mul(a0, b0);
+    SignedLimbs r1 = signed_mul(pa1, pb1);
+    SignedLimbs rm1 = signed_mul(pam1, pbm1);
+    SignedLimbs rm2 = signed_mul(pam2, pbm2);
+    SignedLimbs rinf = signed_mul(a2, b2);
+    
+    // Interpolation
+    SignedLimbs c3 = signed_div_exact(signed_sub(rm2, r1), 3);
+    SignedLimbs c1 = signed_div_exact(signed_sub(r1, rm1), 2);
+    SignedLimbs c2 = signed_sub(rm1, r0);
+    c3 = signed_add(signed_div_exact(signed_sub(c2, c3), 2), signed_add(rinf, rinf));
+    c2 = signed_sub(signed_add(c2, c1), rinf);
+    c1 = signed_sub(c1, c3);
+    
+    Limbs result = r0.mag;
+    limbs_add_shifted(result, c1.mag, k);
+    limbs_add_shifted(result, c2.mag, 2 * k);
+    limbs_add_shifted(result, c3.mag, 3 * k);
+    limbs_add_shifted(result, rinf.mag, 4 * k);
+    return result;
+}
+
+// m^-1 mod R by Newton's iteration inv <- inv (2 - m inv), which doubles the
+// number of correct limbs per round, starting from the inverse mod 2^32.
+MontgomeryBig::MontgomeryBig(const Limbs& modulus) : m(modulus), k(modulus.size()) {
+    uint32_t inv = m[0];
+    for (int i = 0; i < 4; i++) inv *= 2 - m[0] * inv;
+    m_inv.assign(1, inv);
+    for (size_t width = 1; width < k;) {
+        width = min(2 * width, k);
+        Limbs e = limbs_slice(limbs_mul(limbs_slice(m, 0, width), m_inv), 0, width);
+        e.resize(width, 0);
+        Limbs two_minus_e(width); // 2 - e mod 2^(32 width) = ~e + 3
+        uint64_t carry = 3;
+        for (size_t i = 0; i < width; i++) {
+            uint64_t cur = static_cast<uint64_t>(~e[i]) + carry;
+            two_minus_e[i] = static_cast<uint32_t>(cur);
+            carry = cur >> 32;
         }
-        default:
-            cout << "Invalid choice!" << endl;
+        limbs_trim(two_minus_e);
+        m_inv = limbs_slice(limbs_mul(m_inv, two_minus_e), 0, width);
     }
     
-    pressEnterToContinue();
-    return 0;
+    Limbs r_squared(2 * k + 1, 0);
+    r_squared[2 * k] = 1;
+    limbs_divmod(r_squared, m, r2);
 }
 
-void measureFibonacciTime() {
-    cout << "\nFibonacci Algorithm Complexities:" << endl;
-    cout << string(50, '-') << endl;
-    cout << "1. Iterative:" << endl;
-    cout << "   Time: O(n)" << endl;
-    cout << "   Space: O(1)" << endl;
-    cout << "   Best for: Large n" << endl;
-    
-    cout << "\n2. Recursive:" << endl;
-    cout << "   Time: O(2^n) (Exponential!)" << endl;
-    cout << "   Space: O(n) (Call stack)" << endl;
-    cout << "   Best for: Small n, educational purposes" << endl;
-    
-    cout << "\n3. Memoized:" << endl;
-    cout << "   Time: O(n)" << endl;
-    cout << "   Space: O(n)" << endl;
-    cout << "   Best for: Multiple queries" << endl;
+// t - q m is divisible by R because q = t m^-1 mod R, so the low limbs cancel
+// and only the high halves are subtracted (adding m when that goes negative).
+Limbs MontgomeryBig::reduce(const Limbs& t) const {
+    Limbs q = limbs_slice(limbs_mul(limbs_slice(t, 0, k), m_inv), 0, k);
+    Limbs qm = limbs_mul(q, m);
+    Limbs t_high = limbs_slice(t, k, t.size()), qm_high = limbs_slice(qm, k, qm.size());
+    if (limbs_compare(t_high, qm_high) >= 0) return limbs_sub(t_high, qm_high);
+    return limbs_sub(limbs_add(t_high, m), qm_high);
 }
 
-void measureLucasTime() {
-    cout << "\nLucas Algorithm Complexities:" << endl;
-    cout << string(50, '-') << endl;
-    cout << "1. Iterative:" << endl;
-    cout << "   Time: O(n)" << endl;
-    cout << "   Space: O(1)" << endl;
+Limbs MontgomeryBig::mul(const Limbs& a, const Limbs& b) const {
+    return reduce(limbs_mul(a, b));
+}
+
+Limbs MontgomeryBig::add(const Limbs& a, const Limbs& b) const {
+    Limbs sum = limbs_add(a, b);
+    return limbs_compare(sum, m) >= 0 ? limbs_sub(sum, m) : sum;
+}
+
+Limbs MontgomeryBig::sub(const Limbs& a, const Limbs& b) const {
+    if (limbs_compare(a, b) >= 0) return limbs_sub(a, b);
+    return limbs_sub(limbs_add(a, m), b);
+}
+
+Limbs MontgomeryBig::half(const Limbs& a) const {
+    BigInt value;
+    value.limbs = (!a.empty() && (a[0] & 1)) ? limbs_add(a, m) : a;
+    value >>= 1;
+    return value.limbs;
+}
+
+// ========== NTT MULTIPLICATION ==========
+// Operands are split into 16-bit digits and convolved with one forward
+// transform each (one in total when squaring), a pointwise product and an
+// inverse transform. The forward transform is decimation in frequency and
+// leaves its output in bit-reversed order; the inverse is decimation in time
+// and takes that order back, so no permutation pass is needed.
+shared_ptr<const vector<uint64_t>> ntt_root_cache;
+mutex ntt_root_mutex;
+
+// 2^64 = 2^32 - 1 and 2^96 = -1 (mod p), so the high word folds back with
+// a subtraction and a 32x32-bit product. The corrections are masks rather
+// than branches: on transform data they are taken at random and a
+// mispredicted branch costs more than the butterfly itself.
+inline uint64_t ntt_mul(uint64_t a, uint64_t b) {
+    const uint64_t EPSILON = 0xffffffffULL; // 2^64 mod p
+    unsigned __int128 x = static_cast<unsigned __int128>(a) * b;
+    uint64_t low = static_cast<uint64_t>(x), high = static_cast<uint64_t>(x >> 64);
+    uint64_t high_high = high >> 32, high_low = high & EPSILON;
     
-    cout << "\n2. Recursive:" << endl;
-    cout << "   Time: O(2^n)" << endl;
-    cout << "   Space: O(n)" << endl;
+    uint64_t t0 = low - high_high;
+    t0 -= EPSILON & (0 - static_cast<uint64_t>(low < high_high));
+    uint64_t t1 = high_low * EPSILON;
+    uint64_t r = t0 + t1;
+    r += EPSILON & (0 - static_cast<uint64_t>(r < t1));
+    return r - (NTT_PRIME & (0 - static_cast<uint64_t>(r >= NTT_PRIME)));
+}
+
+static inline uint64_t ntt_add(uint64_t a, uint64_t b) {
+    uint64_t s = a + b;
+    return s - (NTT_PRIME & (0 - static_cast<uint64_t>((s < a) | (s >= NTT_PRIME))));
+}
+
+static inline uint64_t ntt_sub(uint64_t a, uint64_t b) {
+    return a - b + (NTT_PRIME & (0 - static_cast<uint64_t>(a < b)));
+}
+
+uint64_t ntt_pow(uint64_t base, uint64_t exp) {
+    uint64_t result = 1;
+    while (exp > 0) {
+        if (exp & 1) result = ntt_mul(result, base);
+        base = ntt_mul(base, base);
+        exp >>= 1;
+    }
+    return result;
+}
+
+// roots[half + j] = w^j for j < half, w a primitive (2 half)th root of unity,
+// so every stage reads its twiddles contiguously. Each level is the even
+// entries of the one above. A table for n serves every smaller length, so
+// the largest one built so far is kept and shared.
+shared_ptr<const vector<uint64_t>> ntt_roots(size_t n) {
+    lock_guard<mutex> guard(ntt_root_mutex);
+    if (ntt_root_cache && ntt_root_cache->size() >= n) return ntt_root_cache;
     
-    cout << "\n3. Memoized:" << endl;
-    cout << "   Time: O(n)" << endl;
-    cout << "   Space: O(n)" << endl;
+    shared_ptr<vector<uint64_t>> roots(new vector<uint64_t>(max<size_t>(n, 2)));
+    vector<uint64_t>& table = *roots;
+    size_t top = table.size() / 2;
+    uint64_t w = ntt_pow(NTT_GENERATOR, (NTT_PRIME - 1) / (2 * top));
+    table[top] = 1;
+    for (size_t j = 1; j < top; j++) table[top + j] = ntt_mul(table[top + j - 1], w);
+    for (size_t half = top / 2; half >= 1; half /= 2) {
+        for (size_t j = 0; j < half; j++) table[half + j] = table[2 * half + 2 * j];
+    }
+    ntt_root_cache = roots;
+    return roots;
 }
 
-void measureHanoiTime() {
-    cout << "\nTower of Hanoi Complexities:" << endl;
-    cout << string(50, '-') << endl;
-    cout << "Time: O(2^n) (Exponential - must make 2^n-1 moves)" << endl;
-    cout << "Space: O(n) (Recursive call stack)" << endl;
-    cout << "\nThis is optimal - cannot be solved in fewer moves!" << endl;
+// Started on first use with one thread per core. Every caller, a range
+// worker or a worker of another pool included, queues into it as an
+// outside thread, so concurrent products share the same threads.
+WorkStealingPool& ntt_pool() {
+    static WorkStealingPool pool(thread::hardware_concurrency());
+    return pool;
 }
 
-// ========== GRAPH VISUALIZER ==========
-void graphVisualizer() {
-    clearScreen();
-    displayHeader("VISUAL GRAPHS");
+// Splits [0, count) into grain-sized ranges run as pool tasks, then waits
+void ntt_parallel(WorkStealingPool& pool, size_t count, size_t grain, const function<void(size_t, size_t)>& body) {
+    if (count <= grain || pool.size() == 1) {
+        body(0, count);
+        return;
+    }
+    TaskGroup group;
+    for (size_t begin = 0; begin < count; begin += grain) {
+        size_t end = min(count, begin + grain);
+        pool.spawn(group, [&body, begin, end]() { body(begin, end); });
+    }
+    pool.wait(group);
+}
+
+// Stages with half >= NTT_BLOCK run one at a time with their butterflies
+// spread over the pool; the rest work on NTT_BLOCK-sized blocks that fit in
+// cache, one task per block running every remaining stage.
+void ntt_forward(vector<uint64_t>& a, const vector<uint64_t>& roots, WorkStealingPool& pool) {
+    size_t n = a.size();
+    size_t half = n / 2;
+    for (; half >= NTT_BLOCK; half /= 2) {
+        const uint64_t* w = roots.data() + half;
+        ntt_parallel(pool, n / 2, NTT_BLOCK, [&, half, w](size_t begin, size_t end) {
+            // Butterfly b pairs a[i] with a[i + half]; runs stop at group ends
+            for (size_t b = begin; b < end;) {
+                uint64_t* x = a.data() + (b / half) * 2 * half;
+                size_t j = b % half, stop = min(half, j + (end - b));
+                b += stop - j;
+                for (; j < stop; j++) {
+                    uint64_t u = x[j], v = x[j + half];
+                    x[j] = ntt_add(u, v);
+                    x[j + half] = ntt_mul(ntt_sub(u, v), w[j]);
+                }
+            }
+        });
+    }
+    size_t block = min(n, 2 * half);
+    ntt_parallel(pool, n / block, 1, [&, block](size_t first, size_t last) {
+        for (size_t start = first * block; start < last * block; start += block) {
+            for (size_t h = block / 2; h >= 1; h /= 2) {
+                const uint64_t* w = roots.data() + h;
+                for (size_t s = start; s < start + block; s += 2 * h) {
+                    for (size_t j = 0; j < h; j++) {
+                        uint64_t u = a[s + j], v = a[s + j + h];
+                        a[s + j] = ntt_add(u, v);
+                        a[s + j + h] = ntt_mul(ntt_sub(u, v), w[j]);
+                    }
+                }
+            }
+        }
+    });
+}
+
+// Mirror image of ntt_forward with w^-j = -w^(half - j); the 1/n scaling
+// is left to the caller.
+void ntt_inverse(vector<uint64_t>& a, const vector<uint64_t>& roots, WorkStealingPool& pool) {
+    size_t n = a.size();
+    size_t block = min(n, NTT_BLOCK);
+    ntt_parallel(pool, n / block, 1, [&, block](size_t first, size_t last) {
+        for (size_t start = first * block; start < last * block; start += block) {
+            for (size_t h = 1; h < block; h *= 2) {
+                const uint64_t* w = roots.data() + h;
+                for (size_t s = start; s < start + block; s += 2 * h) {
+                    uint64_t u = a[s], v = a[s + h];
+                    a[s] = ntt_add(u, v);
+                    a[s + h] = ntt_sub(u, v);
+                    for (size_t j = 1; j < h; j++) {
+                        u = a[s + j];
+                        v = ntt_mul(a[s + j + h], NTT_PRIME - w[h - j]);
+                        a[s + j] = ntt_add(u, v);
+                        a[s + j + h] = ntt_sub(u, v);
+                    }
+                }
+            }
+        }
+    });
+    for (size_t half = block; half < n; half *= 2) {
+        const uint64_t* w = roots.data() + half;
+        ntt_parallel(pool, n / 2, NTT_BLOCK, [&, half, w](size_t begin, size_t end) {
+            for (size_t b = begin; b < end;) {
+                uint64_t* x = a.data() + (b / half) * 2 * half;
+                size_t j = b % half, stop = min(half, j + (end - b));
+                b += stop - j;
+                for (; j < stop; j++) {
+                    uint64_t u = x[j], v = x[j + half];
+                    if (j > 0) v = ntt_mul(v, NTT_PRIME - w[half - j]);
+                    x[j] = ntt_add(u, v);
+                    x[j + half] = ntt_sub(u, v);
+                }
+            }
+        });
+    }
+}
+
+Limbs limbs_mul_ntt(const Limbs& a, const Limbs& b) {
+    size_t digits = 2 * (a.size() + b.size());
+    size_t n = 1;
+    while (n < digits) n *= 2;
+    shared_ptr<const vector<uint64_t>> roots = ntt_roots(n);
+    WorkStealingPool& pool = ntt_pool();
+    bool square = &a == &b || a == b;
     
-    cout << "Available graphs:" << endl;
-    cout << "1. Fibonacci sequence growth" << endl;
-    cout << "2. Lucas sequence growth" << endl;
-    cout << "3. Tower of Hanoi moves growth" << endl;
-    cout << "Enter choice: ";
+    vector<uint64_t> fa(n, 0), fb;
+    for (size_t i = 0; i < a.size(); i++) {
+        fa[2 * i] = a[i] & 0xffff;
+        fa[2 * i + 1] = a[i] >> 16;
+    }
+    ntt_forward(fa, *roots, pool);
+    if (!square) {
+        fb.assign(n, 0);
+        for (size_t i = 0; i < b.size(); i++) {
+            fb[2 * i] = b[i] & 0xffff;
+            fb[2 * i + 1] = b[i] >> 16;
+        }
+        ntt_forward(fb, *roots, pool);
+    }
     
-    int choice, n;
-    cin >> choice;
+    const vector<uint64_t>& other = square ? fa : fb;
+    uint64_t n_inverse = ntt_pow(n, NTT_PRIME - 2);
+    ntt_parallel(pool, n, 1 << 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) fa[i] = ntt_mul(ntt_mul(fa[i], other[i]), n_inverse);
+    });
+    fb.clear();
+    fb.shrink_to_fit();
+    ntt_inverse(fa, *roots, pool);
     
-    if (choice != 4) {
-        cout << "Enter number of terms (1-20): ";
-        cin >> n;
-        n = min(n, 20); // Limit for display
+    // Each sum is below 2^60, so the carry fits comfortably in 64 bits
+    Limbs result(a.size() + b.size());
+    uint64_t carry = 0;
+    for (size_t i = 0; i < result.size(); i++) {
+        uint64_t low = fa[2 * i] + carry;
+        uint64_t high = fa[2 * i + 1] + (low >> 16);
+        result[i] = static_cast<uint32_t>((low & 0xffff) | (high << 16));
+        carry = high >> 16;
+    }
+    limbs_trim(result);
+    return result;
+}
+
+// ========== DECIMAL OUTPUT ==========
+// Divide and conquer: a number below 10^(18 * 2^k) is split by 10^(9 * 2^k)
+// into a high and a low half, each converted the same way, the low half
+// zero-padded to its full width. Every split is two multiplications against
+// a cached reciprocal, so a conversion costs O(M(n) log n) instead of the
+// O(n^2) of peeling 10^9 chunks off the whole number.
+vector<shared_ptr<const DecimalPower>> decimal_power_cache;
+mutex decimal_power_mutex;
+
+shared_ptr<const DecimalPower> decimal_power(size_t level) {
+    lock_guard<mutex> guard(decimal_power_mutex);
+    while (decimal_power_cache.size() <= level) {
+        shared_ptr<DecimalPower> next(new DecimalPower());
+        if (decimal_power_cache.empty()) {
+            next->power = Limbs(1, 1000000000);
+        } else {
+            const Limbs& below = decimal_power_cache.back()->power;
+            next->power = limbs_mul(below, below);
+        }
+        if (next->power.size() >= RECIPROCAL_THRESHOLD) next->reciprocal = limbs_reciprocal(next->power);
+        decimal_power_cache.push_back(next);
+    }
+    return decimal_power_cache[level];
+}
+
+// floor(B^(2k) / d) for a k-limb d, B = 2^32. One Newton step from the
+// reciprocal of the top half of d (plus two guard limbs) is within a few
+// units; the loops at the end make it exact.
+Limbs limbs_reciprocal(const Limbs& d) {
+    size_t k = d.size();
+    Limbs scale(2 * k + 1, 0);
+    scale[2 * k] = 1;
+    if (k < RECIPROCAL_THRESHOLD) {
+        Limbs remainder;
+        return limbs_divmod(scale, d, remainder);
     }
     
-    switch(choice) {
-        case 1:
-            printFibonacciGraph(n);
-            break;
-        case 2:
-            printLucasGraph(n);
-            break;
-        case 3:
-            printHanoiGraph(n);
-            break;
-        default:
-            cout << "Invalid choice!" << endl;
+    // x = top B^(k-h) approximates the result; its low limbs are zero, so
+    // products with x are taken with top and shifted
+    size_t h = (k + 1) / 2 + 2;
+    Limbs top = limbs_reciprocal(limbs_slice(d, k - h, k));
+    Limbs x = top, product = limbs_mul(d, top);
+    x.insert(x.begin(), k - h, 0);
+    product.insert(product.begin(), k - h, 0);
+    
+    // x += x (B^(2k) - d x) / B^(2k), keeping product = d x
+    SignedLimbs error = signed_sub(SignedLimbs(scale), SignedLimbs(product));
+    Limbs step = limbs_slice(limbs_mul(top, error.mag), k + h, SIZE_MAX);
+    Limbs step_product = limbs_mul(d, step);
+    if (error.neg) {
+        x = limbs_sub(x, step);
+        product = limbs_sub(product, step_product);
+    } else {
+        x = limbs_add(x, step);
+        product = limbs_add(product, step_product);
     }
     
-    pressEnterToContinue();
+    const Limbs one(1, 1);
+    while (limbs_compare(product, scale) > 0) {
+        x = limbs_sub(x, one);
+        product = limbs_sub(product, d);
+    }
+    for (Limbs next = limbs_add(product, d); limbs_compare(next, scale) <= 0; next = limbs_add(product, d)) {
+        x = limbs_add(x, one);
+        product = next;
+    }
+    return x;
 }
 
-void printFibonacciGraph(int n) {
-    cout << "\nFibonacci Sequence Growth:" << endl;
-    cout << "n  Value  Graph" << endl;
-    cout << string(40, '-') << endl;
+// Quotient and remainder of a < power^2 by power. With the reciprocal this
+// is Barrett's estimate, from the top k + 1 limbs of a only, which is at
+// most two short.
+static Limbs divmod_decimal_power(const Limbs& a, const DecimalPower& p, Limbs& remainder) {
+    if (p.reciprocal.empty()) return limbs_divmod(a, p.power, remainder);
     
-    for (int i = 0; i <= n; i++) {
-        long long value = fibonacci_iterative(i);
-        int bars = min(static_cast<int>(log2(value + 1)) * 2, 30);
-        cout << setw(2) << i << "  " 
-             << setw(6) << value << "  "
-             << string(bars, '#') << endl;
+    size_t k = p.power.size();
+    Limbs quotient = limbs_slice(limbs_mul(limbs_slice(a, k - 1, SIZE_MAX), p.reciprocal), k + 1, SIZE_MAX);
+    remainder = limbs_sub(a, limbs_mul(quotient, p.power));
+    const Limbs one(1, 1);
+    while (limbs_compare(remainder, p.power) >= 0) {
+        remainder = limbs_sub(remainder, p.power);
+        quotient = limbs_add(quotient, one);
     }
+    return quotient;
 }
 
-void printLucasGraph(int n) {
-    cout << "\nLucas Sequence Growth:" << endl;
-    cout << "n  Value  Graph" << endl;
-    cout << string(40, '-') << endl;
+// Base case: base 10^9 chunks peeled off the bottom, written out top first
+// with the leading chunk unpadded and the whole padded to width
+static void decimal_basecase(Limbs a, size_t width, string& out) {
+    vector<uint32_t> chunks;
+    while (!a.empty()) chunks.push_back(limbs_divmod_small(a, 1000000000));
+    if (chunks.empty()) {
+        out.append(width, '0');
+        return;
+    }
     
-    for (int i = 0; i <= n; i++) {
-        long long value = lucas_iterative(i);
-        int bars = min(static_cast<int>(log2(value + 1)) * 2, 30);
-        cout << setw(2) << i << "  " 
-             << setw(6) << value << "  "
-             << string(bars, '#') << endl;
+    char text[16];
+    size_t length = to_chars(text, text + sizeof(text), chunks.back()).ptr - text;
+    size_t digits = length + 9 * (chunks.size() - 1);
+    if (width > digits) out.append(width - digits, '0');
+    out.append(text, length);
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        size_t size = to_chars(text, text + sizeof(text), chunks[i]).ptr - text;
+        out.append(9 - size, '0');
+        out.append(text, size);
     }
 }
 
-void printHanoiGraph(int n) {
-    cout << "\nTower of Hanoi Moves Growth:" << endl;
-    cout << "Disks  Moves  Graph" << endl;
-    cout << string(40, '-') << endl;
+// Appends a < 10^(18 * 2^level), zero-padded to exactly that many digits
+// when pad is set
+static void decimal_recursive(const Limbs& a, const vector<shared_ptr<const DecimalPower>>& powers,
+                              size_t level, bool pad, string& out) {
+    if (level == 0 || a.size() <= DECIMAL_THRESHOLD) {
+        decimal_basecase(a, pad ? size_t(18) << level : 0, out);
+        return;
+    }
+    
+    Limbs low;
+    Limbs high = divmod_decimal_power(a, *powers[level], low);
+    if (!high.empty() || pad) decimal_recursive(high, powers, level - 1, pad, out);
+    decimal_recursive(low, powers, level - 1, pad || !high.empty(), out);
+}
+
+void limbs_append_decimal(const Limbs& a, string& out) {
+    if (a.empty()) {
+        out += '0';
+        return;
+    }
+    if (a.size() <= DECIMAL_THRESHOLD) {
+        decimal_basecase(a, 0, out);
+        return;
+    }
+    
+    // a < 2^bits <= 10^digits
+    BigInt value;
+    value.limbs = a;
+    size_t digits = static_cast<size_t>(ceil(value.bitLength() * log10(2.0)));
+    size_t level = 0;
+    while ((size_t(18) << level) < digits) level++;
     
-    for (int i = 1; i <= n; i++) {
-        long long moves = pow(2, i) - 1;
-        int bars = min(static_cast<int>(log2(moves + 1)), 30);
-        cout << setw(5) << i << "  " 
-             << setw(6) << moves << "  "
-             << string(bars, '*') << endl;
+    vector<shared_ptr<const DecimalPower>> powers;
+    for (size_t i = 0; i <= level; i++) powers.push_back(decimal_power(i));
+    out.reserve(out.size() + digits);
+    decimal_recursive(a, powers, level, false, out);
+}
+
+OutputBuffer& OutputBuffer::operator<<(const BigInt& value) {
+    limbs_append_decimal(value.limbs, buffer);
+    return spill();
+}
+
+bool OutputBuffer::flush() {
+    if (!buffer.empty()) {
+        ok = fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size() && ok;
+        buffer.clear();
     }
+    ok = fflush(out) == 0 && ok;
+    return ok;
 }
\ No newline at end of file